@@ -0,0 +1,329 @@
+// benchmark.cpp - Antonio Mastroianni
+// Measures the time and heap allocations of each of the VendingMachine's hot paths so that regressions in vending.h can be caught
+
+//NOTE: Builds on Linux with   g++ -std=c++17 -O2 -I../Project1 benchmark.cpp -o benchmark
+//      Results are written as CSV to the file given with --csv (benchmark_results.csv by default)
+
+//counts every heap allocation made by the program through allocations.h
+#define VENDING_COUNT_ALLOCATIONS
+
+#include "vending.h"
+#include "bytecode.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+//discards everything the machine displays so that only the work itself is measured
+class NullBuffer : public std::streambuf
+{
+protected:
+	int overflow(int c) override { return c; }
+	std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+//holds the measurement of one benchmark
+struct Result
+{
+	std::string name;
+	std::string parameter;
+	double nanosecondsPerOp;
+	double allocationsPerOp;
+	long long iterations;
+};
+
+//keeps the compiler from removing work whose result is otherwise unused
+static volatile long long sink = 0;
+
+//controls how long each benchmark runs for
+static double minimumSeconds = 0.2;
+static std::vector<Result> results;
+
+//*****************************************************************************************************
+//Runs an operation against freshly copied machines until enough time has passed and records the result
+//*****************************************************************************************************
+void measure(const std::string& name, const std::string& parameter, const VendingMachine& prepared, const std::function<void(VendingMachine&)>& operation)
+{
+	using Clock = std::chrono::steady_clock;
+	const int BATCHSIZE = 256;
+
+	//the machines are copied before timing starts so the copies are not measured
+	std::vector<VendingMachine> machines(BATCHSIZE, prepared);
+	long long iterations = 0;
+	double seconds = 0;
+	unsigned long long allocations = 0;
+
+	while (seconds < minimumSeconds) {
+		for (auto& machine : machines)
+			{ machine = prepared; }
+
+		unsigned long long allocationsBefore = heapAllocations;
+		Clock::time_point start = Clock::now();
+		for (auto& machine : machines)
+			{ operation(machine); }
+		Clock::time_point end = Clock::now();
+
+		allocations += heapAllocations - allocationsBefore;
+		seconds += std::chrono::duration<double>(end - start).count();
+		iterations += BATCHSIZE;
+	}
+
+	results.push_back({ name, parameter, seconds * 1e9 / iterations, double(allocations) / iterations, iterations });
+	std::cerr << std::left << std::setw(24) << name << std::setw(28) << parameter
+		<< std::right << std::setw(12) << std::fixed << std::setprecision(1) << results.back().nanosecondsPerOp << " ns/op"
+		<< std::setw(10) << std::setprecision(2) << results.back().allocationsPerOp << " allocs/op\n";
+}
+
+//***************************************************************
+//Builds a machine holding the given amount of every stocked item
+//***************************************************************
+VendingMachine stockedMachine(int inventoryLevel)
+{
+	VendingMachine machine;
+	std::string quantity = std::to_string(inventoryLevel);
+
+	const char* items[] = { "ADD CUPS ", "ADD COLA COKE ", "ADD COLA PEPSI ", "ADD COLA SPRITE ", "ADD COLA FANTA ", "ADD COLA FAYGO ",
+		"ADD COINS NICKEL ", "ADD COINS DIME ", "ADD COINS QUARTER ", "ADD BILLS 1 ", "ADD BILLS 5 " };
+	for (const char* item : items)
+		{ machine.parseCommand(item + quantity); }
+
+	return machine;
+}
+
+//*************************************************************
+//Deposits an amount in cents using the largest pieces possible
+//*************************************************************
+void depositCents(VendingMachine& machine, int cents)
+{
+	for (; cents >= 500; cents -= 500) { machine.billCmd("5"); }
+	for (; cents >= 100; cents -= 100) { machine.billCmd("1"); }
+	for (; cents >= 25; cents -= 25) { machine.coinCmd("QUARTER"); }
+	for (; cents >= 10; cents -= 10) { machine.coinCmd("DIME"); }
+	for (; cents >= 5; cents -= 5) { machine.coinCmd("NICKEL"); }
+}
+
+//***********************************************
+//Benchmarks parseCommand across all the commands
+//***********************************************
+void benchmarkParseCommand()
+{
+	VendingMachine service = stockedMachine(100);
+	VendingMachine normal = stockedMachine(100);
+	normal.parseCommand("LOCK password");
+
+	//each command is given a line it accepts, run in a mode that allows it without changing that mode
+	struct Line { const char* text; bool serviceMode; };
+	const Line lines[] = {
+		{ "unlock wrongpassword", false },
+		{ "help", true },
+		{ "coin quarter", true },
+		{ "bill 1", true },
+		{ "cola coke", true },
+		{ "return", true },
+		{ "status", true },
+		{ "exit", true },
+		{ "add cola coke 1", true },
+		{ "remove coins dime 1", true },
+		{ "lock wrongpassword", true },
+	};
+
+	for (const Line& line : lines) {
+		std::string text = line.text;
+		measure("parseCommand", text, line.serviceMode ? service : normal,
+			[&text](VendingMachine& machine) { sink += machine.parseCommand(text); });
+	}
+}
+
+//**************************************************************************************
+//Benchmarks running commands compiled once, for comparison with parsing them every time
+//**************************************************************************************
+void benchmarkCompiledScript()
+{
+	VendingMachine service = stockedMachine(100);
+	const char* lines[] = { "coin quarter", "bill 1", "cola coke", "return", "status", "add cola coke 1", "remove coins dime 1" };
+
+	for (const char* line : lines) {
+		CompiledScript<VendingMachine> program;
+		program.add(line, service);
+		measure("compiledCommand", line, service,
+			[&program](VendingMachine& machine) { sink += program.run(0, machine); });
+	}
+}
+
+//**********************************************************
+//Benchmarks convertBufferToValue over several deposit sizes
+//**********************************************************
+void benchmarkConvertBufferToValue()
+{
+	for (int coins : { 0, 10, 100, 1000, 10000 }) {
+		VendingMachine machine;
+		for (int i = 0; i < coins; i++)
+			{ machine.coinCmd("NICKEL"); }
+
+		measure("convertBufferToValue", "coins=" + std::to_string(coins), machine,
+			[](VendingMachine& m) { sink += m.convertBufferToValue(); });
+	}
+}
+
+//*************************************************************************************************************
+//Benchmarks checkIfChangeAvailable, building its change table and dispenseChange over deposits and inventories
+//*************************************************************************************************************
+void benchmarkChange()
+{
+	for (int inventoryLevel : { 0, 10, 1000 }) {
+		for (int deposit : { 150, 500, 1000, 5000 }) {
+			VendingMachine machine = stockedMachine(inventoryLevel);
+			depositCents(machine, deposit);
+			std::string parameter = "inventory=" + std::to_string(inventoryLevel) + " deposit=" + std::to_string(deposit);
+
+			//a machine that never checked for change has no table yet, so its first check times the table being built
+			measure("changeTableBuild", parameter, machine,
+				[](VendingMachine& m) { ChangePlan plan; sink += m.checkIfChangeAvailable(plan); });
+
+			//every later check with the same coins held looks the amount up in the table already built, as a sale does
+			VendingMachine warmed(machine);
+			ChangePlan warmup;
+			sink += warmed.checkIfChangeAvailable(warmup);
+			measure("checkIfChangeAvailable", parameter, warmed,
+				[](VendingMachine& m) { ChangePlan plan; sink += m.checkIfChangeAvailable(plan); });
+
+			//every copy of the machine is the same, so one plan works out the change for all of them
+			ChangePlan plan;
+			if (VendingMachine(machine).checkIfChangeAvailable(plan)) {
+				measure("dispenseChange", parameter, machine,
+					[&plan](VendingMachine& m) { m.takeChange(plan); m.dispenseChange(plan); });
+			}
+		}
+	}
+}
+
+//*****************************************
+//Benchmarks rendering of the status report
+//*****************************************
+void benchmarkStatus()
+{
+	for (int inventoryLevel : { 0, 1000 }) {
+		measure("statusCmd", "inventory=" + std::to_string(inventoryLevel), stockedMachine(inventoryLevel),
+			[](VendingMachine& m) { m.statusCmd(); });
+	}
+}
+
+//**********************************************
+//Benchmarks toUpper over several string lengths
+//**********************************************
+void benchmarkToUpper()
+{
+	VendingMachine machine;
+
+	for (int length : { 4, 15, 64 }) {
+		std::string text(length, 'q');
+		measure("toUpper", "length=" + std::to_string(length), machine,
+			[&text](VendingMachine& m) { sink += m.toUpper(text).size(); });
+	}
+}
+
+//*****************************************************
+//Benchmarks product lookups over several catalog sizes
+//*****************************************************
+void benchmarkCatalog()
+{
+	for (int products : { 5, 100, 5000 }) {
+		Catalog catalog;
+		for (int i = 0; i < products; i++)
+			{ catalog.add("SKU" + std::to_string(i)); }
+
+		VendingMachine machine;
+		machine.setCatalog(catalog);
+		std::string name = "sku" + std::to_string(products - 1);
+
+		measure("convertStringColaToInt", "products=" + std::to_string(products), machine,
+			[&name](VendingMachine& m) { sink += m.convertStringColaToInt(name); });
+	}
+}
+
+//***************************************************************************
+//Benchmarks a purchase with its sale appended to a group committed event log
+//***************************************************************************
+void benchmarkEventLog()
+{
+	const char* logName = "benchmark_events.log";
+	std::remove(logName);
+
+	{
+		EventLog eventLog(logName);
+		VendingMachine machine = stockedMachine(1000);
+		machine.setEventLog(&eventLog);
+		depositCents(machine, 150);
+
+		measure("colaCmd", "event log", machine,
+			[](VendingMachine& m) { m.colaCmd("COKE", ""); });
+	}
+
+	std::remove(logName);
+}
+
+//***************************************************************************************
+//Benchmarks the timing timeCommand wraps around every command when VENDING_METRICS is on
+//***************************************************************************************
+void benchmarkCommandTimer()
+{
+	LatencyHistogram latency;
+
+	measure("commandTimer", "read clock twice and record", VendingMachine(),
+		[&latency](VendingMachine&) {
+			std::uint64_t start = readCycleCounter();
+			latency.record(readCycleCounter() - start);
+		});
+	sink += latency.count();
+}
+
+//*************
+//Main Function
+//*************
+int main(int argc, char* argv[])
+{
+	std::string csvName = "benchmark_results.csv";
+
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "--csv" && i + 1 < argc) { csvName = argv[++i]; }
+		else if (argument == "--min-time" && i + 1 < argc) { minimumSeconds = std::atof(argv[++i]); }
+		else {
+			std::cerr << "Usage: " << argv[0] << " [--csv <file>] [--min-time <seconds>]\n";
+			return 2;
+		}
+	}
+
+	//silences the machine's output for the whole run
+	NullBuffer nullBuffer;
+	std::streambuf* consoleBuffer = std::cout.rdbuf(&nullBuffer);
+
+	benchmarkParseCommand();
+	benchmarkCompiledScript();
+	benchmarkConvertBufferToValue();
+	benchmarkChange();
+	benchmarkStatus();
+	benchmarkToUpper();
+	benchmarkCatalog();
+	benchmarkEventLog();
+	benchmarkCommandTimer();
+
+	std::cout.rdbuf(consoleBuffer);
+
+	//writes the results in a machine readable form
+	std::ofstream csv(csvName);
+	if (!csv) {
+		std::cerr << "Unable to open " << csvName << '\n';
+		return 2;
+	}
+
+	csv << "benchmark,parameter,ns_per_op,allocs_per_op,iterations\n";
+	for (const Result& result : results) {
+		csv << result.name << ",\"" << result.parameter << "\"," << std::fixed << std::setprecision(2)
+			<< result.nanosecondsPerOp << ',' << result.allocationsPerOp << ',' << result.iterations << '\n';
+	}
+
+	return 0;
+}
@@ -0,0 +1,321 @@
+// alerts.h - Antonio Mastroianni
+// Keeps every product, the cups and each coin and bill in a heap ordered by how far each is above its low stock threshold
+
+//NOTE: Items are numbered with the catalog's products first, then the cups, then the coins and then the bills
+//      An item is low once fewer of it are left than its threshold, and a threshold of 0 never alerts
+//      Nothing here is thread safe, so machines sharing alerts must run on one thread, as the server's sessions do
+
+#ifndef ALERTS_H
+#define ALERTS_H
+
+#include <algorithm>
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "catalog.h"
+#include "currency.h"
+
+//an item that went low, or stopped being low, and the count it was at when it did
+struct StockAlert
+{
+	int item;
+	int count;
+	int threshold;
+	bool low; //cleared when the item was restocked back up to its threshold
+};
+
+//the low stock thresholds of every item, with the items nearest to or furthest below their thresholds found first
+class StockAlerts
+{
+public:
+
+	const static int MAXRECENT = 64; //the most alerts kept to be read, after which the oldest are dropped
+	const static int PRODUCTTHRESHOLD = 5; //the thresholds every item starts with
+	const static int CUPSTHRESHOLD = 10;
+	const static int COINTHRESHOLD = 10;
+	const static int BILLTHRESHOLD = 0; //bills are only ever paid in, so running out of them is no problem
+
+private:
+
+	struct Item
+	{
+		int count = 0;
+		int threshold = 0;
+		int place = 0; //where the item is in the heap
+		bool low = false;
+		bool counted = false; //set once the item's count is first known
+	};
+
+	int products;
+	int coins;
+	std::vector<Item> items;
+	std::vector<int> heap; //the items, each no further above its threshold than either of the two below it
+	std::vector<int> lowList; //the items found low when last listed
+	StockAlert recent[MAXRECENT];
+	int recentStart = 0;
+	int recentCount = 0;
+	std::vector<std::function<void(const StockAlert&)>> subscribers;
+
+	int margin(int) const;
+	void swapPlaces(int, int);
+	void siftUp(int);
+	void siftDown(int);
+	void reposition(int);
+	void alert(int);
+
+public:
+
+	StockAlerts(int, int, int);
+	StockAlerts(const StockAlerts&) = delete;
+	StockAlerts& operator=(const StockAlerts&) = delete;
+	int size() const;
+	int cupsItem() const;
+	int denominationItem(int) const;
+	void update(int, int);
+	void setThreshold(int, int);
+	int threshold(int) const;
+	int count(int) const;
+	const std::vector<int>& lowItems();
+	void subscribe(std::function<void(const StockAlert&)>);
+	bool nextRecent(StockAlert&);
+};
+
+template <typename Currency>
+std::string_view stockItemName(const Catalog&, int);
+
+
+//*****************************************************************************************************************************
+//Creates alerts for the given amount of products, of coins and of coins and bills together, each item at its default threshold
+//*****************************************************************************************************************************
+StockAlerts::StockAlerts(int productCount, int coinCount, int denominationCount)
+	: products(productCount), coins(coinCount), items(productCount + 1 + denominationCount), heap(items.size())
+{
+	for (int item = 0; item < size(); item++) {
+		if (item < products) { items[item].threshold = PRODUCTTHRESHOLD; }
+		else if (item == cupsItem()) { items[item].threshold = CUPSTHRESHOLD; }
+		else if (item < denominationItem(coins)) { items[item].threshold = COINTHRESHOLD; }
+		else { items[item].threshold = BILLTHRESHOLD; }
+
+		//every count starts at 0, so the heap needs no ordering until the first count is known
+		heap[item] = item;
+		items[item].place = item;
+	}
+	lowList.reserve(items.size());
+}
+
+//*********************************************************************************
+//Returns how many of an item are left above its threshold, negative once it is low
+//*********************************************************************************
+int StockAlerts::margin(int item) const
+{
+	return items[item].count - items[item].threshold;
+}
+
+//********************************************************************
+//Swaps the items at two places in the heap and tells each where it is
+//********************************************************************
+void StockAlerts::swapPlaces(int a, int b)
+{
+	std::swap(heap[a], heap[b]);
+	items[heap[a]].place = a;
+	items[heap[b]].place = b;
+}
+
+//*********************************************************************
+//Moves an item up the heap past every item further above its threshold
+//*********************************************************************
+void StockAlerts::siftUp(int place)
+{
+	while (place > 0) {
+		int parent = (place - 1) / 2;
+		if (margin(heap[parent]) <= margin(heap[place])) { return; }
+		swapPlaces(parent, place);
+		place = parent;
+	}
+}
+
+//****************************************************************************
+//Moves an item down the heap past every item nearer to or below its threshold
+//****************************************************************************
+void StockAlerts::siftDown(int place)
+{
+	const int placed = static_cast<int>(heap.size());
+
+	while (true) {
+		int lowest = place;
+		for (int child = place * 2 + 1; child <= place * 2 + 2 && child < placed; child++) {
+			if (margin(heap[child]) < margin(heap[lowest])) { lowest = child; }
+		}
+		if (lowest == place) { return; }
+		swapPlaces(place, lowest);
+		place = lowest;
+	}
+}
+
+//****************************************************************************************
+//Puts an item back in order after its count or threshold changed and alerts if it crossed
+//****************************************************************************************
+void StockAlerts::reposition(int item)
+{
+	//only one of the two ever moves the item, in O(log n) steps
+	siftUp(items[item].place);
+	siftDown(items[item].place);
+
+	bool low = margin(item) < 0;
+	if (low != items[item].low) {
+		items[item].low = low;
+		alert(item);
+	}
+}
+
+//********************************************************************************
+//Keeps an alert about an item for the ALERTS command and passes it to subscribers
+//********************************************************************************
+void StockAlerts::alert(int item)
+{
+	StockAlert raised = { item, items[item].count, items[item].threshold, items[item].low };
+
+	//once full, the oldest alert is overwritten by the newest
+	recent[(recentStart + recentCount) % MAXRECENT] = raised;
+	if (recentCount < MAXRECENT) { recentCount++; }
+	else { recentStart = (recentStart + 1) % MAXRECENT; }
+
+	for (const std::function<void(const StockAlert&)>& subscriber : subscribers)
+		{ subscriber(raised); }
+}
+
+//***************************************
+//Returns how many items have a threshold
+//***************************************
+int StockAlerts::size() const
+{
+	return static_cast<int>(items.size());
+}
+
+//*****************************
+//Returns the cups' item number
+//*****************************
+int StockAlerts::cupsItem() const
+{
+	return products;
+}
+
+//************************************************************************
+//Returns the item number of a coin or bill, numbered with the coins first
+//************************************************************************
+int StockAlerts::denominationItem(int denomination) const
+{
+	return products + 1 + denomination;
+}
+
+//*************************************************************************************
+//Sets how many of an item are held now, alerting if that takes it across its threshold
+//*************************************************************************************
+void StockAlerts::update(int item, int count)
+{
+	if (item < 0 || item >= size()) { return; }
+
+	//an item's first count is where it stands rather than a change, so it is placed without alerting
+	if (!items[item].counted) {
+		items[item].counted = true;
+		items[item].count = count;
+		items[item].low = margin(item) < 0;
+		siftUp(items[item].place);
+		siftDown(items[item].place);
+		return;
+	}
+
+	if (count == items[item].count) { return; }
+	items[item].count = count;
+	reposition(item);
+}
+
+//*********************************************************************************************
+//Sets how few of an item may be left before it is low, alerting if it is now on the other side
+//*********************************************************************************************
+void StockAlerts::setThreshold(int item, int threshold)
+{
+	if (item < 0 || item >= size()) { return; }
+
+	items[item].threshold = std::max(threshold, 0);
+	reposition(item);
+}
+
+//********************************
+//Returns the threshold of an item
+//********************************
+int StockAlerts::threshold(int item) const
+{
+	return items[item].threshold;
+}
+
+//*********************************************
+//Returns the count an item was last updated to
+//*********************************************
+int StockAlerts::count(int item) const
+{
+	return items[item].count;
+}
+
+//**********************************************************************************************************
+//Returns every item that is low, furthest below its threshold first, visiting only the low part of the heap
+//**********************************************************************************************************
+const std::vector<int>& StockAlerts::lowItems()
+{
+	lowList.clear();
+
+	//an item below the top of the heap is never further below its threshold than the item above it, so the search stops at
+	//the first item that is not low on every path down
+	if (!heap.empty() && margin(heap[0]) < 0) { lowList.push_back(heap[0]); }
+	for (std::size_t next = 0; next < lowList.size(); next++) {
+		int place = items[lowList[next]].place;
+		for (int child = place * 2 + 1; child <= place * 2 + 2 && child < static_cast<int>(heap.size()); child++) {
+			if (margin(heap[child]) < 0) { lowList.push_back(heap[child]); }
+		}
+	}
+
+	std::sort(lowList.begin(), lowList.end(), [&](int a, int b) {
+		return margin(a) != margin(b) ? margin(a) < margin(b) : a < b;
+	});
+	return lowList;
+}
+
+//****************************************************************
+//Calls a function with every later alert, as soon as it is raised
+//****************************************************************
+void StockAlerts::subscribe(std::function<void(const StockAlert&)> subscriber)
+{
+	subscribers.push_back(std::move(subscriber));
+}
+
+//************************************************************************************
+//Takes the oldest alert that has not been read yet, returning false if there are none
+//************************************************************************************
+bool StockAlerts::nextRecent(StockAlert& next)
+{
+	if (recentCount == 0) { return false; }
+
+	next = recent[recentStart];
+	recentStart = (recentStart + 1) % MAXRECENT;
+	recentCount--;
+	return true;
+}
+
+//******************************************************************
+//Returns the name an item is shown by, from its catalog or currency
+//******************************************************************
+template <typename Currency>
+std::string_view stockItemName(const Catalog& catalog, int item)
+{
+	const int coins = coinCount<Currency>();
+	const int products = catalog.size();
+
+	if (item < products) { return catalog.name(item); }
+	if (item == products) { return "Cups"; }
+
+	int denomination = item - products - 1;
+	return denomination < coins ? Currency::COINS[denomination].statusLabel : Currency::BILLS[denomination - coins].statusLabel;
+}
+
+#endif
@@ -0,0 +1,39 @@
+// allocations.h - Antonio Mastroianni
+// Counts every heap allocation the program makes when built with VENDING_COUNT_ALLOCATIONS, such as in debug builds
+
+#ifndef ALLOCATIONS_H
+#define ALLOCATIONS_H
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+//the amount of heap allocations made since the program started, which stays 0 unless counting is built in
+inline std::atomic<unsigned long long> heapAllocations{ 0 };
+
+//NOTE: the replacement operators below may only be defined once in a program, so only one source file may be built with them
+#ifdef VENDING_COUNT_ALLOCATIONS
+
+//keeps the replacements out of line, as a free inlined into a caller looks to the compiler like it was paired with a new
+#if defined(_MSC_VER)
+#define ALLOCATION_NOINLINE __declspec(noinline)
+#else
+#define ALLOCATION_NOINLINE __attribute__((noinline))
+#endif
+
+ALLOCATION_NOINLINE void* operator new(std::size_t size)
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* memory = std::malloc(size == 0 ? 1 : size))
+		{ return memory; }
+	throw std::bad_alloc();
+}
+ALLOCATION_NOINLINE void* operator new[](std::size_t size) { return operator new(size); }
+ALLOCATION_NOINLINE void operator delete(void* memory) noexcept { std::free(memory); }
+ALLOCATION_NOINLINE void operator delete[](void* memory) noexcept { std::free(memory); }
+ALLOCATION_NOINLINE void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+ALLOCATION_NOINLINE void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+
+#endif
+
+#endif
@@ -0,0 +1,240 @@
+// analytics.h - Antonio Mastroianni
+// Counts sales of each product and deposits of each coin and bill in rings of minute, hour and day buckets
+
+//NOTE: Counting an event only adds to one bucket of each ring, and a window is read from at most one ring's buckets, so
+//      neither ever looks back over the history of every sale
+
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+//what was sold and deposited over the last minutes, hours and days, kept in a fixed amount of memory
+class SalesAnalytics
+{
+public:
+
+	const static int MAXWINDOW = 30 * 24 * 60; //the longest window, in minutes, that can be counted
+
+private:
+
+	//a ring of buckets that each count every item over the same span of minutes, the oldest reused for the newest
+	struct BucketRing
+	{
+		int span; //the minutes each bucket covers
+		int buckets;
+		std::int64_t newest = 0; //the bucket holding the current minute, counted in spans since the clock began
+		std::vector<std::uint32_t> counts; //every item's count in each bucket, one bucket after another
+		std::vector<std::uint64_t> totals; //every item's count over the whole ring, kept as buckets are added and reused
+
+		void advance(std::int64_t, int);
+		std::uint32_t* bucket(std::int64_t, int);
+	};
+
+	int products;
+	int denominations;
+	std::int64_t started; //the minute counting began, before which nothing can have been counted
+	BucketRing rings[3];
+	std::vector<std::uint64_t> window; //every item's count over the window read last
+	std::vector<int> ranking; //products ordered by their count over the window read last
+
+	void count(int, std::int64_t);
+
+public:
+
+	SalesAnalytics(int, int);
+	static std::int64_t currentMinute();
+	void recordSale(int, std::int64_t = currentMinute());
+	void recordDeposit(int, std::int64_t = currentMinute());
+	int readWindow(int, std::int64_t = currentMinute());
+	std::uint64_t sales(int) const;
+	std::uint64_t totalSales() const;
+	std::uint64_t deposits(int) const;
+	int topSellers(int, const int*&);
+};
+
+
+//*************************************************************************************
+//Moves a ring on to the given minute, emptying every bucket that falls out of its span
+//*************************************************************************************
+void SalesAnalytics::BucketRing::advance(std::int64_t minute, int items)
+{
+	std::int64_t current = minute / span;
+	if (current <= newest) { return; }
+
+	//only the buckets skipped over need emptying, and no more than the whole ring
+	std::int64_t stale = std::min<std::int64_t>(current - newest, buckets);
+	for (std::int64_t b = current - stale + 1; b <= current; b++) {
+		std::uint32_t* reused = &counts[static_cast<std::size_t>(b % buckets) * items];
+		for (int item = 0; item < items; item++) {
+			totals[item] -= reused[item];
+			reused[item] = 0;
+		}
+	}
+	newest = current;
+}
+
+//*********************************************************************************
+//Returns the counts of the bucket holding the given span, which must still be held
+//*********************************************************************************
+std::uint32_t* SalesAnalytics::BucketRing::bucket(std::int64_t spanNumber, int items)
+{
+	return &counts[static_cast<std::size_t>(spanNumber % buckets) * items];
+}
+
+//****************************************************************************************
+//Creates empty analytics for the given amount of products and of coins and bills together
+//****************************************************************************************
+SalesAnalytics::SalesAnalytics(int productCount, int denominationCount)
+	: products(productCount), denominations(denominationCount), started(currentMinute())
+{
+	const int items = products + denominations;
+
+	//a minute ring for the last hour, an hour ring for the last day and a day ring for the last month
+	const int spans[3] = { 1, 60, 24 * 60 };
+	const int buckets[3] = { 60, 24, MAXWINDOW / (24 * 60) };
+	for (int r = 0; r < 3; r++) {
+		rings[r].span = spans[r];
+		rings[r].buckets = buckets[r];
+		rings[r].newest = started / spans[r];
+		rings[r].counts.assign(static_cast<std::size_t>(buckets[r]) * items, 0);
+		rings[r].totals.assign(items, 0);
+	}
+
+	window.assign(items, 0);
+	ranking.resize(products);
+}
+
+//**************************************************
+//Returns the minutes since the system clock's epoch
+//**************************************************
+std::int64_t SalesAnalytics::currentMinute()
+{
+	return std::chrono::duration_cast<std::chrono::minutes>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+//***************************************************************
+//Adds one to an item's count in the current bucket of every ring
+//***************************************************************
+void SalesAnalytics::count(int item, std::int64_t minute)
+{
+	const int items = products + denominations;
+
+	for (BucketRing& ring : rings) {
+		ring.advance(minute, items);
+
+		//an event from before the newest bucket, such as from a clock that was set back, is counted as happening now
+		ring.bucket(ring.newest, items)[item]++;
+		ring.totals[item]++;
+	}
+}
+
+//**************************************
+//Counts a sale of the product in a slot
+//**************************************
+void SalesAnalytics::recordSale(int product, std::int64_t minute)
+{
+	if (product >= 0 && product < products) { count(product, minute); }
+}
+
+//************************************************************************************
+//Counts a deposit of a coin or bill, numbered with the coins first and then the bills
+//************************************************************************************
+void SalesAnalytics::recordDeposit(int denomination, std::int64_t minute)
+{
+	if (denomination >= 0 && denomination < denominations) { count(products + denomination, minute); }
+}
+
+//************************************************************************************************************
+//Counts every item over the last given minutes, to within one bucket, and returns how many minutes it covered
+//************************************************************************************************************
+int SalesAnalytics::readWindow(int minutes, std::int64_t minute)
+{
+	const int items = products + denominations;
+	minutes = std::min(std::max(minutes, 1), static_cast<int>(MAXWINDOW)); //copies the limit, which is not defined outside the class for a reference to bind to
+
+	//uses the finest ring that reaches back far enough
+	BucketRing* ring = &rings[2];
+	for (BucketRing& candidate : rings) {
+		if (minutes <= candidate.span * candidate.buckets) {
+			ring = &candidate;
+			break;
+		}
+	}
+	for (BucketRing& each : rings)
+		{ each.advance(minute, items); }
+
+	//the newest bucket has only covered the minutes of its span that have passed so far, and none came before counting began
+	int wanted = std::min((minutes + ring->span - 1) / ring->span, ring->buckets);
+	std::int64_t covered = (wanted - 1) * ring->span + (minute - ring->newest * ring->span) + 1;
+	covered = std::clamp<std::int64_t>(minute - started + 1, 1, covered);
+
+	//a window as long as the ring is its running totals, otherwise its newest buckets are added together
+	if (wanted == ring->buckets) {
+		std::copy(ring->totals.begin(), ring->totals.end(), window.begin());
+		return static_cast<int>(covered);
+	}
+	std::fill(window.begin(), window.end(), 0);
+	for (std::int64_t b = ring->newest - wanted + 1; b <= ring->newest; b++) {
+		const std::uint32_t* counts = ring->bucket(b, items);
+		for (int item = 0; item < items; item++)
+			{ window[item] += counts[item]; }
+	}
+
+	return static_cast<int>(covered);
+}
+
+//************************************************************
+//Returns how many of a product sold over the window read last
+//************************************************************
+std::uint64_t SalesAnalytics::sales(int product) const
+{
+	return window[product];
+}
+
+//********************************************************
+//Returns how many products sold over the window read last
+//********************************************************
+std::uint64_t SalesAnalytics::totalSales() const
+{
+	std::uint64_t total = 0;
+	for (int product = 0; product < products; product++)
+		{ total += window[product]; }
+
+	return total;
+}
+
+//***************************************************************************
+//Returns how many of a coin or bill were deposited over the window read last
+//***************************************************************************
+std::uint64_t SalesAnalytics::deposits(int denomination) const
+{
+	return window[products + denomination];
+}
+
+//******************************************************************************************************
+//Ranks the products that sold most over the window read last and returns how many of them sold anything
+//******************************************************************************************************
+int SalesAnalytics::topSellers(int most, const int*& places)
+{
+	most = std::min(most, products);
+	for (int product = 0; product < products; product++)
+		{ ranking[product] = product; }
+
+	//only the top of the ranking is sorted, with ties kept in catalog order
+	std::partial_sort(ranking.begin(), ranking.begin() + most, ranking.end(), [&](int a, int b) {
+		return window[a] != window[b] ? window[a] > window[b] : a < b;
+	});
+
+	int sold = 0;
+	while (sold < most && window[ranking[sold]] > 0)
+		{ sold++; }
+
+	places = ranking.data();
+	return sold;
+}
+
+#endif
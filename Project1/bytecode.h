@@ -0,0 +1,221 @@
+// bytecode.h - Antonio Mastroianni
+// Compiles a script of commands once into instructions that name their coin, bill or product by index, and runs them without parsing again
+
+//NOTE: Only a command whose every parameter was valid when compiled becomes an instruction, any other line is kept as typed and
+//      parsed when it runs, so it reports exactly the error it would in a script that was not compiled
+//      Whether a command may run depends on the mode the machine is in then, so that is still checked as each instruction runs
+
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "vending.h"
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//the operations an instruction runs
+const int OPPARSE = 0; //a line that is parsed when it runs, because it could not be compiled
+const int OPCOIN = 1; //operand is the coin deposited
+const int OPBILL = 2; //operand is the bill deposited
+const int OPCOLA = 3; //operand is the product's slot
+const int OPRETURN = 4;
+const int OPSTATUS = 5;
+const int OPADDCOLA = 6; //operand is the product's slot, quantity is how many are added
+const int OPADDCUPS = 7; //quantity is how many are added
+const int OPADDMONEY = 8; //operand is the coin or bill, numbered with the coins first, quantity is how many are added
+const int OPREMOVEMONEY = 9; //operand is the coin or bill, numbered with the coins first, quantity is how many are removed
+
+//a compiled command, with the text it needs kept as places in the script's text rather than strings of its own
+struct Instruction
+{
+	std::uint8_t opcode = OPPARSE;
+	std::uint8_t command = 0; //the command's place in the command records, which its time is recorded under
+	std::uint8_t modes = 0; //the modes the command may run in
+	bool noIce = false;
+	std::int32_t operand = 0;
+	std::int32_t quantity = 0;
+	std::uint32_t line = 0; //where the line as typed starts in the script's text
+	std::uint32_t lineLength = 0;
+	std::uint32_t echo = 0; //where the option the command's messages repeat, upper cased, starts in the script's text
+	std::uint32_t echoLength = 0;
+};
+
+//a script compiled for one machine's catalog and currency
+template <typename Machine>
+class CompiledScript
+{
+private:
+
+	std::vector<Instruction> instructions;
+	std::string text; //every line as typed followed by the same line upper cased, one after another
+	std::string upperLine; //the line being compiled, upper cased so it can be split into tokens
+	int compiledCount = 0;
+
+	std::string_view textAt(std::uint32_t, std::uint32_t) const;
+	void compile(Instruction&, Machine&);
+
+public:
+
+	void add(std::string_view, Machine&);
+	int size() const;
+	int compiled() const;
+	bool run(int, Machine&) const;
+};
+
+
+//*********************************************************
+//Returns the part of the script's text an instruction uses
+//*********************************************************
+template <typename Machine>
+std::string_view CompiledScript<Machine>::textAt(std::uint32_t start, std::uint32_t length) const
+{
+	return std::string_view(text).substr(start, length);
+}
+
+//**************************************************************************************************************************
+//Compiles the next line of a script for a machine, skipping it if it is blank, and keeps it to be parsed if it is not valid
+//**************************************************************************************************************************
+template <typename Machine>
+void CompiledScript<Machine>::add(std::string_view line, Machine& machine)
+{
+	//skips blank lines, as running a script does
+	if (line.find_first_not_of(" \t\r") == std::string_view::npos) { return; }
+
+	//keeps the line as typed, for parsing it if needs be, and upper cased, for the options its messages repeat
+	Instruction instruction;
+	instruction.line = static_cast<std::uint32_t>(text.size());
+	instruction.lineLength = static_cast<std::uint32_t>(line.size());
+	text.append(line);
+
+	upperLine.assign(line.data(), line.size());
+	for (char& c : upperLine)
+		{ c = static_cast<char>(toupper(static_cast<unsigned char>(c))); }
+	compile(instruction, machine);
+	text.append(upperLine);
+
+	if (instruction.opcode != OPPARSE) { compiledCount++; }
+	instructions.push_back(instruction);
+}
+
+//************************************************************************************************************
+//Turns an upper cased line into an instruction if it is a command that can be compiled and all of it is valid
+//************************************************************************************************************
+template <typename Machine>
+void CompiledScript<Machine>::compile(Instruction& instruction, Machine& machine)
+{
+	using Currency = typename Machine::CurrencyType;
+	const int coins = coinCount<Currency>();
+	const int bills = denominationCount<Currency>() - coins;
+
+	CommandTokens tokens;
+	tokens.split(upperLine);
+
+	//a command that does not exist, or is given too few or too many parameters, is left to report its own error
+	const CommandRecord<Machine>* record = commandTable<Machine>.find(tokens[0]);
+	if (record == nullptr || tokens.count == CommandTokens::MAXTOKENS) { return; }
+	int parameters = tokens.count - 1;
+	if (parameters < record->minParameters || parameters > record->maxParameters) { return; }
+
+	//the option the command's messages repeat is taken from the upper cased copy of the line added after it
+	std::string_view command = record->name;
+	std::string_view option = tokens[1];
+	auto echoOf = [&](std::string_view token) {
+		instruction.echo = static_cast<std::uint32_t>(text.size() + (token.data() - upperLine.data()));
+		instruction.echoLength = static_cast<std::uint32_t>(token.size());
+	};
+	auto isQuantity = [](std::string_view s) { return s.find_first_not_of("0123456789") == std::string_view::npos; };
+	int opcode = OPPARSE;
+
+	if (command == "COIN") {
+		instruction.operand = machine.convertStringCoinToInt(option);
+		if (instruction.operand >= 0 && instruction.operand < coins) { opcode = OPCOIN; }
+		echoOf(option);
+	}
+	else if (command == "BILL") {
+		instruction.operand = machine.convertStringBillToInt(option);
+		if (instruction.operand >= 0 && instruction.operand < bills) { opcode = OPBILL; }
+		echoOf(option);
+	}
+	else if (command == "COLA") {
+		instruction.operand = machine.convertStringColaToInt(option);
+		instruction.noIce = (tokens[2] == "-NO_ICE");
+		if (instruction.operand >= 0 && (tokens[2] == "" || instruction.noIce)) { opcode = OPCOLA; }
+		echoOf(option);
+	}
+	else if (command == "RETURN") { opcode = OPRETURN; }
+	else if (command == "STATUS") { opcode = OPSTATUS; }
+	else if (command == "ADD" && option == "COLA" && parameters == 3 && isQuantity(tokens[3])) {
+		instruction.operand = machine.convertStringColaToInt(tokens[2]);
+		instruction.quantity = machine.convertStringToNumber(tokens[3]);
+		if (instruction.operand >= 0) { opcode = OPADDCOLA; }
+		echoOf(tokens[2]);
+	}
+	else if (command == "ADD" && option == "CUPS" && parameters == 2 && isQuantity(tokens[2])) {
+		instruction.quantity = machine.convertStringToNumber(tokens[2]);
+		opcode = OPADDCUPS;
+	}
+	else if ((command == "ADD" || command == "REMOVE") && (option == "COINS" || option == "BILLS") && parameters == 3 && isQuantity(tokens[3])) {
+		int index = (option == "COINS") ? machine.convertStringCoinToInt(tokens[2]) : machine.convertStringBillToInt(tokens[2]);
+		instruction.operand = (option == "COINS") ? index : coins + index;
+		instruction.quantity = machine.convertStringToNumber(tokens[3]);
+		if (index >= 0 && index < ((option == "COINS") ? coins : bills)) { opcode = (command == "ADD") ? OPADDMONEY : OPREMOVEMONEY; }
+		echoOf(tokens[2]);
+	}
+
+	if (opcode == OPPARSE) { return; }
+	instruction.opcode = static_cast<std::uint8_t>(opcode);
+	instruction.command = static_cast<std::uint8_t>(record - commandRecords<Machine>);
+	instruction.modes = static_cast<std::uint8_t>(record->modes);
+}
+
+//********************************************************************
+//Returns how many lines were added, whether compiled or kept to parse
+//********************************************************************
+template <typename Machine>
+int CompiledScript<Machine>::size() const
+{
+	return static_cast<int>(instructions.size());
+}
+
+//******************************************************
+//Returns how many lines were compiled into instructions
+//******************************************************
+template <typename Machine>
+int CompiledScript<Machine>::compiled() const
+{
+	return compiledCount;
+}
+
+//********************************************************************************************
+//Runs one instruction against a machine and returns whether it ran without reporting an error
+//********************************************************************************************
+template <typename Machine>
+bool CompiledScript<Machine>::run(int index, Machine& machine) const
+{
+	const Instruction& instruction = instructions[index];
+	int currentMode = machine.getModeStatus() ? SERVICEMODE : NORMALMODE;
+
+	//a line that was not compiled, or a command the machine's mode does not allow now, is parsed so it reports its own error
+	if (instruction.opcode == OPPARSE || (instruction.modes & currentMode) == 0)
+		{ return machine.parseCommand(textAt(instruction.line, instruction.lineLength)); }
+
+	//every parameter was looked up when the script was compiled, so the command runs straight from its indexes
+	std::string_view echo = textAt(instruction.echo, instruction.echoLength);
+	return machine.runCommand(instruction.command, [&]() {
+		switch (instruction.opcode) {
+		case OPCOIN: machine.depositCoin(instruction.operand, echo); break;
+		case OPBILL: machine.depositBill(instruction.operand, echo); break;
+		case OPCOLA: machine.buyCola(instruction.operand, echo, instruction.noIce ? "-NO_ICE" : ""); break;
+		case OPRETURN: machine.returnCmd(); break;
+		case OPSTATUS: machine.statusCmd(); break;
+		case OPADDCOLA: machine.addCola(instruction.operand, instruction.quantity, echo); break;
+		case OPADDCUPS: machine.addCups(instruction.quantity); break;
+		case OPADDMONEY: machine.addDenomination(instruction.operand, instruction.quantity, echo); break;
+		case OPREMOVEMONEY: machine.removeDenomination(instruction.operand, instruction.quantity, echo); break;
+		}
+	});
+}
+
+#endif
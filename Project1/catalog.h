@@ -0,0 +1,221 @@
+// catalog.h - Antonio Mastroianni
+// Holds the products a vending machine sells and finds a product's slot from its name in constant time
+
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//the product names of a machine, each held once, with a hash index from the case folded name to the product's slot
+class Catalog
+{
+private:
+
+	const static int MAXNAMELENGTH = 64;
+	const static int MAXPRODUCTS = 65535; //so every product's slot fits in an event record
+	std::string names; //every product name, one after another
+	std::vector<std::uint32_t> nameStart = { 0 }; //where each product's name starts in names, plus where the next would
+	std::vector<std::uint32_t> slotHash; //the hash of each product's case folded name
+	std::vector<int> index; //an open addressing table of product slot + 1, or 0 for an empty entry
+	std::uint64_t catalogFingerprint = 14695981039346656037ull; //changes with every product added
+
+	static std::uint32_t hashName(std::string_view);
+	void rebuildIndex(std::size_t);
+
+public:
+
+	Catalog() = default;
+	Catalog(std::initializer_list<std::string_view>);
+	int size() const;
+	std::string_view name(int) const;
+	int find(std::string_view) const;
+	bool add(std::string_view);
+	std::uint64_t fingerprint() const;
+	static const Catalog& standard();
+	static bool sameName(std::string_view, std::string_view);
+};
+
+bool loadCatalog(const std::string&, Catalog&);
+
+
+//***************************************
+//Creates a catalog of the products given
+//***************************************
+Catalog::Catalog(std::initializer_list<std::string_view> products)
+{
+	for (std::string_view product : products)
+		{ add(product); }
+}
+
+//***************************************************************
+//Returns the catalog of the five colas every machine starts with
+//***************************************************************
+const Catalog& Catalog::standard()
+{
+	static const Catalog colas = { "Coke", "Pepsi", "Sprite", "Fanta", "Faygo" };
+	return colas;
+}
+
+//****************************************
+//Hashes a name without regard to its case
+//****************************************
+std::uint32_t Catalog::hashName(std::string_view s)
+{
+	std::uint32_t hash = 2166136261u;
+	for (char c : s)
+		{ hash = (hash ^ static_cast<unsigned char>(toupper(static_cast<unsigned char>(c)))) * 16777619u; }
+
+	return hash;
+}
+
+//*****************************************
+//Compares two names without regard to case
+//*****************************************
+bool Catalog::sameName(std::string_view a, std::string_view b)
+{
+	if (a.size() != b.size()) { return false; }
+
+	for (std::size_t i = 0; i < a.size(); i++) {
+		if (toupper(static_cast<unsigned char>(a[i])) != toupper(static_cast<unsigned char>(b[i])))
+			{ return false; }
+	}
+
+	return true;
+}
+
+//*****************************************************************************
+//Rebuilds the hash index with the given capacity, which must be a power of two
+//*****************************************************************************
+void Catalog::rebuildIndex(std::size_t capacity)
+{
+	index.assign(capacity, 0);
+
+	for (int slot = 0; slot < size(); slot++) {
+		std::size_t entry = slotHash[slot] & (capacity - 1);
+		while (index[entry] != 0)
+			{ entry = (entry + 1) & (capacity - 1); }
+		index[entry] = slot + 1;
+	}
+}
+
+//*********************************************
+//Returns the amount of products in the catalog
+//*********************************************
+int Catalog::size() const
+{
+	return static_cast<int>(slotHash.size());
+}
+
+//*****************************************************
+//Returns the name of a product exactly as it was added
+//*****************************************************
+std::string_view Catalog::name(int slot) const
+{
+	return std::string_view(names).substr(nameStart[slot], nameStart[slot + 1] - nameStart[slot]);
+}
+
+//***************************************************************************************
+//Returns the slot of the product with the given name in any case, or -1 if there is none
+//***************************************************************************************
+int Catalog::find(std::string_view s) const
+{
+	if (index.empty()) { return -1; }
+
+	std::uint32_t hash = hashName(s);
+	std::size_t mask = index.size() - 1;
+
+	//probes from the name's home entry until the product or an empty entry is found
+	for (std::size_t entry = hash & mask; index[entry] != 0; entry = (entry + 1) & mask) {
+		int slot = index[entry] - 1;
+		if (slotHash[slot] == hash && sameName(name(slot), s))
+			{ return slot; }
+	}
+
+	return -1;
+}
+
+//******************************************************************************************
+//Adds a product to the end of the catalog, returning false if the name is unusable or taken
+//******************************************************************************************
+bool Catalog::add(std::string_view s)
+{
+	//a name must be a single command token
+	if (s.empty() || s.size() > MAXNAMELENGTH || s.find_first_of(" \t\n\v\f\r") != std::string_view::npos || find(s) >= 0)
+		{ return false; }
+	if (size() >= MAXPRODUCTS) { return false; }
+
+	names.append(s.data(), s.size());
+	nameStart.push_back(static_cast<std::uint32_t>(names.size()));
+	slotHash.push_back(hashName(s));
+
+	//keeps the index at most half full so probes stay short
+	if (index.size() < 2 * slotHash.size())
+		{ rebuildIndex(std::max<std::size_t>(16, index.size() * 2)); }
+	else {
+		std::size_t mask = index.size() - 1;
+		std::size_t entry = slotHash.back() & mask;
+		while (index[entry] != 0)
+			{ entry = (entry + 1) & mask; }
+		index[entry] = size();
+	}
+
+	for (char c : s)
+		{ catalogFingerprint = (catalogFingerprint ^ static_cast<unsigned char>(toupper(static_cast<unsigned char>(c)))) * 1099511628211ull; }
+	catalogFingerprint = (catalogFingerprint ^ '\n') * 1099511628211ull;
+
+	return true;
+}
+
+//****************************************************************************
+//Returns a value that differs between catalogs of different products or order
+//****************************************************************************
+std::uint64_t Catalog::fingerprint() const
+{
+	return catalogFingerprint;
+}
+
+//***************************************************************************************
+//Loads a catalog from a file of one product name per line, where # starts a comment line
+//***************************************************************************************
+bool loadCatalog(const std::string& fileName, Catalog& catalog)
+{
+	std::ifstream file(fileName);
+	if (!file) {
+		std::cerr << "Unable to open " << fileName << '\n';
+		return false;
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+
+		//trims the line and skips it if it is blank or a comment
+		std::size_t start = line.find_first_not_of(" \t\r");
+		if (start == std::string::npos || line[start] == '#') { continue; }
+		std::size_t end = line.find_last_not_of(" \t\r");
+		std::string_view product = std::string_view(line).substr(start, end - start + 1);
+
+		if (!catalog.add(product)) {
+			std::cerr << fileName << " line " << lineNumber << ": " << product << " is not a single word, is already in the catalog or is one product too many\n";
+			return false;
+		}
+	}
+
+	if (catalog.size() == 0) {
+		std::cerr << fileName << " holds no products\n";
+		return false;
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,162 @@
+// change.h - Antonio Mastroianni
+// Works out exactly which amounts of change can be made from the money held in the vending machine
+
+#ifndef CHANGE_H
+#define CHANGE_H
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+const static int MAXDENOMINATIONS = 12;
+
+//the change a purchase will pay out, worked out once before anything is dispensed
+struct ChangePlan
+{
+	bool possible = false; //whether the amount can be paid exactly from what is held
+	int amount = 0; //the amount of change in cents
+	int used[MAXDENOMINATIONS] = {}; //how many of each denomination to pay out, largest first
+};
+
+//caches which amounts of change can be made from a limited number of each denomination
+class ChangeTable
+{
+private:
+
+	bool valid = false; //false once the inventory the table was built from has changed
+	int amountOfDenominations = 0;
+	int unit = 1; //every denomination is a multiple of this many cents
+	int coveredAmount = -1; //the largest amount, in units, the table holds an answer for
+	int reach = 0; //the largest amount, in units, the table was asked to cover, which may be more than is held
+	long long totalValue = 0; //the value, in units, of everything held, which a full machine can take past the most an int holds
+	int values[MAXDENOMINATIONS] = {}; //the value of each denomination in units, largest first
+	int builtCounts[MAXDENOMINATIONS] = {}; //how many of each denomination were held when the table was built
+	std::vector<int> needed; //for each denomination and amount, the fewest of that denomination used to make the amount, or -1
+
+	void build(int, const int[], const int[], int);
+
+public:
+
+	void countsChanged(const int[]);
+	bool canMake(int, const int[], const int[], int);
+	void plan(int, ChangePlan&) const;
+};
+
+
+//**************************************************************************************************************
+//Marks the table as out of date after the money held has changed, unless none of the change reaches its answers
+//**************************************************************************************************************
+void ChangeTable::countsChanged(const int counts[])
+{
+	if (!valid) { return; }
+
+	//a count only shapes the table up to as many of its denomination as fit in the amount covered, so a sale that leaves
+	//plenty of every coin keeps the table as it is
+	long long total = 0;
+	for (int d = 0; d < amountOfDenominations; d++) {
+		int fits = coveredAmount / values[d];
+		if (std::min(counts[d], fits) != std::min(builtCounts[d], fits)) {
+			valid = false;
+			return;
+		}
+		total += static_cast<long long>(values[d]) * counts[d];
+	}
+
+	//a table cut short by the total held could cover more once that total changes
+	if (coveredAmount < reach && total != totalValue) {
+		valid = false;
+		return;
+	}
+	totalValue = total;
+	std::copy(counts, counts + amountOfDenominations, builtCounts);
+}
+
+//**************************************************************************************
+//Rebuilds the table for every amount up to the limit given, using a bounded coin change
+//**************************************************************************************
+void ChangeTable::build(int limit, const int denominationValues[], const int counts[], int denominations)
+{
+	amountOfDenominations = denominations;
+
+	//works in the largest unit every denomination is a multiple of to keep the table small
+	unit = 0;
+	for (int d = 0; d < denominations; d++)
+		{ unit = std::gcd(unit, denominationValues[d]); }
+	if (unit == 0) { unit = 1; }
+
+	//the table never needs to go past the total value held
+	totalValue = 0;
+	for (int d = 0; d < denominations; d++) {
+		values[d] = denominationValues[d] / unit;
+		builtCounts[d] = counts[d];
+		totalValue += static_cast<long long>(values[d]) * counts[d];
+	}
+	reach = limit / unit;
+	coveredAmount = static_cast<int>(std::clamp(totalValue, 0LL, static_cast<long long>(reach)));
+	int size = coveredAmount + 1;
+
+	//makes room for the whole reach, and at least the change from two of the largest denomination, so a table cut short by the
+	//total held, or asked for a little more change than before, can grow without allocating again
+	int room = std::max(reach, 2 * values[0]);
+	needed.reserve(static_cast<std::size_t>(room + 1) * denominations);
+	needed.assign(static_cast<std::size_t>(size) * denominations, -1);
+
+	//adds one denomination at a time, using as few of it as possible on top of the denominations before it
+	for (int d = 0; d < denominations; d++) {
+		int* row = &needed[static_cast<std::size_t>(d) * size];
+		const int* previousRow = d > 0 ? &needed[static_cast<std::size_t>(d - 1) * size] : nullptr;
+
+		for (int amount = 0; amount < size; amount++) {
+			bool madeWithoutThis = (previousRow != nullptr) ? previousRow[amount] >= 0 : amount == 0;
+
+			if (madeWithoutThis)
+				{ row[amount] = 0; }
+			else if (amount >= values[d] && row[amount - values[d]] >= 0 && row[amount - values[d]] < counts[d])
+				{ row[amount] = row[amount - values[d]] + 1; }
+		}
+	}
+
+	valid = true;
+}
+
+//****************************************************************************************
+//Checks if an amount of change can be made exactly, rebuilding the table only when needed
+//****************************************************************************************
+bool ChangeTable::canMake(int amount, const int denominationValues[], const int counts[], int denominations)
+{
+	if (amount == 0) { return true; }
+	if (amount < 0) { return false; }
+
+	//rebuilds the table at the same reach if the inventory changed, or doubles its reach if the amount is past what it covers,
+	//so a machine giving ever larger change only makes room for the table a few times
+	int grownReach = std::max(amount, 2 * reach * unit);
+	if (!valid)
+		{ build(amount / unit > reach ? grownReach : reach * unit, denominationValues, counts, denominations); }
+	else if (amount / unit > coveredAmount && coveredAmount < totalValue)
+		{ build(grownReach, denominationValues, counts, denominations); }
+
+	if (amount % unit != 0 || amount / unit > coveredAmount)
+		{ return false; }
+
+	return needed[static_cast<std::size_t>(amountOfDenominations - 1) * (coveredAmount + 1) + amount / unit] >= 0;
+}
+
+//***************************************************************************************
+//Fills a plan with how many of each denomination make up an amount canMake just accepted
+//***************************************************************************************
+void ChangeTable::plan(int amount, ChangePlan& changePlan) const
+{
+	int remaining = amount / unit;
+	int* used = changePlan.used;
+	changePlan.possible = true;
+	changePlan.amount = amount;
+
+	//uses as few of the smallest denomination as can make the amount, then as few of the next smallest, and so on, which keeps
+	//small coins for later but does not always pay the fewest coins, as 30 cents is paid as 3 dimes rather than a quarter and a nickel
+	for (int d = amountOfDenominations - 1; d >= 0; d--) {
+		used[d] = (remaining > 0) ? needed[static_cast<std::size_t>(d) * (coveredAmount + 1) + remaining] : 0;
+		remaining -= used[d] * values[d];
+	}
+}
+
+#endif
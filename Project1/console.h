@@ -0,0 +1,111 @@
+// console.h - Antonio Mastroianni
+// Colors the interactive prompt with ANSI escape codes written into the output stream, and leaves output that is not a terminal plain
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <cstdio>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+//the colors the prompt uses, as ANSI foreground color codes
+const int CONSOLERED = 31;
+const int CONSOLEWHITE = 97;
+
+//changes the color of what is written to standard output, if it is a terminal that shows colors
+class ConsoleColor
+{
+private:
+
+	std::ostream& stream;
+	bool enabled; //cleared when standard output is a file or pipe, so no escape codes are ever written to it
+	int current = 0; //the color last written, so writing it again can be skipped
+
+	static bool enableEscapeCodes();
+
+public:
+
+	explicit ConsoleColor(std::ostream& = std::cout);
+	~ConsoleColor();
+	ConsoleColor(const ConsoleColor&) = delete;
+	ConsoleColor& operator=(const ConsoleColor&) = delete;
+	void set(int);
+	bool isEnabled() const;
+};
+
+bool isTerminal(std::FILE*);
+
+
+//************************************************************
+//Returns whether a standard stream is connected to a terminal
+//************************************************************
+bool isTerminal(std::FILE* file)
+{
+#ifdef _WIN32
+	return _isatty(_fileno(file)) != 0;
+#else
+	return isatty(fileno(file)) != 0;
+#endif
+}
+
+//*******************************************************************************
+//Lets the terminal act on escape codes, returning false if it is unable to do so
+//*******************************************************************************
+bool ConsoleColor::enableEscapeCodes()
+{
+#ifdef _WIN32
+	//the Windows console only acts on escape codes once virtual terminal processing is turned on
+	HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+	DWORD mode = 0;
+	return GetConsoleMode(console, &mode) && SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#else
+	return true;
+#endif
+}
+
+//***********************************************************************************
+//Creates colors for a stream that writes to standard output, used only on a terminal
+//***********************************************************************************
+ConsoleColor::ConsoleColor(std::ostream& sink)
+	: stream(sink), enabled(isTerminal(stdout) && enableEscapeCodes())
+{
+}
+
+//****************************************************************
+//Puts the terminal back to its own color when the program is done
+//****************************************************************
+ConsoleColor::~ConsoleColor()
+{
+	if (enabled && current != 0) { stream << "\x1b[0m" << std::flush; }
+}
+
+//**************************************************************************************
+//Sets the color of what is written next, as an escape code sent with the text it colors
+//**************************************************************************************
+void ConsoleColor::set(int color)
+{
+	if (!enabled || color == current) { return; }
+
+	//the escape code is only buffered, so it reaches the terminal in the same write as the text after it
+	stream << "\x1b[" << color << 'm';
+	current = color;
+}
+
+//****************************************
+//Returns whether colors are being written
+//****************************************
+bool ConsoleColor::isEnabled() const
+{
+	return enabled;
+}
+
+#endif
@@ -0,0 +1,94 @@
+// currency.h - Antonio Mastroianni
+// Describes the coins and bills of each currency a vending machine can be built for
+
+#ifndef CURRENCY_H
+#define CURRENCY_H
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+//a coin or bill: the name it is added by, another name it may be deposited by, its value and its row in the status report
+struct Denomination
+{
+	std::string_view name;
+	std::string_view alias; //empty if the denomination has no other name
+	int value; //the value in the currency's smallest unit, such as cents
+	std::string_view statusLabel;
+};
+
+//the coins and bills of United States dollars, which every machine uses unless it is built for another currency
+struct UsDollar
+{
+	constexpr static std::string_view SYMBOL = "$"; //shown before an amount of money
+	constexpr static Denomination COINS[] = {
+		{ "NICKEL",  "5",  5,  "Nickels" },
+		{ "DIME",    "10", 10, "Dimes" },
+		{ "QUARTER", "25", 25, "Quarters" },
+	};
+	constexpr static Denomination BILLS[] = {
+		{ "1", "", 100, "One Dollar Bills" },
+		{ "5", "", 500, "Five Dollar Bills" },
+	};
+};
+
+//the coins and notes of euros
+struct Euro
+{
+	constexpr static std::string_view SYMBOL = "EUR ";
+	constexpr static Denomination COINS[] = {
+		{ "FIVECENT",   "5",   5,   "Five Cent Coins" },
+		{ "TENCENT",    "10",  10,  "Ten Cent Coins" },
+		{ "TWENTYCENT", "20",  20,  "Twenty Cent Coins" },
+		{ "FIFTYCENT",  "50",  50,  "Fifty Cent Coins" },
+		{ "EURO",       "100", 100, "One Euro Coins" },
+		{ "TWOEURO",    "200", 200, "Two Euro Coins" },
+	};
+	constexpr static Denomination BILLS[] = {
+		{ "5",  "", 500,  "Five Euro Notes" },
+		{ "10", "", 1000, "Ten Euro Notes" },
+		{ "20", "", 2000, "Twenty Euro Notes" },
+	};
+};
+
+//lists the values of a currency's coins or bills in the same order
+template <std::size_t Count>
+constexpr std::array<int, Count> denominationValues(const Denomination (&denominations)[Count])
+{
+	std::array<int, Count> values = {};
+	for (std::size_t i = 0; i < Count; i++)
+		{ values[i] = denominations[i].value; }
+
+	return values;
+}
+
+//the amount of coins a currency has, numbered before its bills wherever both are counted
+template <typename Currency>
+constexpr int coinCount()
+{
+	return static_cast<int>(std::size(Currency::COINS));
+}
+
+//the amount of coins and bills a currency has together
+template <typename Currency>
+constexpr int denominationCount()
+{
+	return static_cast<int>(std::size(Currency::COINS) + std::size(Currency::BILLS));
+}
+
+//calls a function once for each index below a compile time count, written out in full rather than as a loop
+template <typename Function, std::size_t... Index>
+constexpr void unrollEach(Function&& function, std::index_sequence<Index...>)
+{
+	(function(std::integral_constant<int, static_cast<int>(Index)>()), ...);
+}
+
+template <int Count, typename Function>
+constexpr void unroll(Function&& function)
+{
+	unrollEach(function, std::make_index_sequence<Count>());
+}
+
+#endif
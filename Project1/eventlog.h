@@ -0,0 +1,325 @@
+// eventlog.h - Antonio Mastroianni
+// Keeps an append-only binary ledger of every change to the vending machine's stock and money
+
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//the kinds of event a record may hold
+const int EVENTSALE = 1; //item is the cola sold, cents is the amount deposited for it
+const int EVENTREFUND = 2; //cents is the amount returned
+const int EVENTRESTOCK = 3; //item is the cola or cups changed, quantity is how many were added
+const int EVENTMONEY = 4; //item is the coin or bill changed, quantity is how many were added or (if negative) removed
+const int EVENTLOCK = 5;
+const int EVENTUNLOCK = 6;
+
+//the item of a restock record for cups, every other restock item is a product's catalog slot
+const int EVENTITEMCUPS = 65535;
+
+//one event in the log, written to the file exactly as it is held in memory
+struct EventRecord
+{
+	std::uint64_t sequence = 0; //counts up from 1 over the whole life of the log
+	std::int64_t time = 0; //microseconds since 1970
+	std::uint16_t type = 0;
+	std::uint16_t item = 0;
+	std::int32_t quantity = 0;
+	std::int32_t cents = 0;
+	std::uint32_t checksum = 0; //covers every byte before it
+};
+
+static_assert(sizeof(EventRecord) == 32, "an event record must keep its fixed size");
+
+//***************************************************************
+//Works out the checksum of every byte of a record before its own
+//***************************************************************
+std::uint32_t eventChecksum(const EventRecord& record)
+{
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&record);
+	std::uint32_t hash = 2166136261u;
+
+	for (std::size_t i = 0; i < offsetof(EventRecord, checksum); i++)
+		{ hash = (hash ^ bytes[i]) * 16777619u; }
+
+	return hash;
+}
+
+//appends events to a log file, syncing them to disk in groups from a thread of its own so appending never waits on the disk
+class EventLog
+{
+private:
+
+	const static int RESERVEDEVENTS = 4096; //the events a batch holds before appending one needs more memory
+	int file = -1;
+	std::chrono::microseconds latencyBound; //the longest an event waits before it is synced to disk
+	std::mutex lock;
+	std::condition_variable wakeWriter;
+	std::condition_variable wakeFlushers;
+	std::vector<EventRecord> pending; //events appended but not yet written
+	std::vector<EventRecord> writing; //events being written and synced by the writer thread
+	std::chrono::steady_clock::time_point oldestPending; //when the first event still waiting in pending was appended
+	std::uint64_t nextSequence = 1;
+	std::uint64_t durableSequence = 0; //the last event known to be on disk
+	bool flushRequested = false;
+	bool stopping = false;
+	bool failed = false;
+	std::thread writer;
+
+	void writeBatches();
+
+public:
+
+	explicit EventLog(const std::string&, std::chrono::microseconds = std::chrono::milliseconds(10));
+	~EventLog();
+	EventLog(const EventLog&) = delete;
+	EventLog& operator=(const EventLog&) = delete;
+	bool isOpen() const;
+	void append(int, int, int, int);
+	bool flush();
+};
+
+//reads a log back in large blocks, stopping at the end or at the first damaged record
+class EventLogReader
+{
+private:
+
+	const static int BLOCKSIZE = 4096; //the amount of records read from the file at once
+	std::ifstream file;
+	std::vector<EventRecord> block;
+	std::size_t position = 0;
+	std::size_t filled = 0;
+	bool damaged = false; //set once a record fails its checksum
+
+public:
+
+	explicit EventLogReader(const std::string&);
+	bool isOpen() const;
+	bool isDamaged() const;
+	bool next(EventRecord&);
+};
+
+
+//**********************************************************************************************
+//Opens a log for appending, dropping any partly written record a crash may have left at its end
+//**********************************************************************************************
+EventLog::EventLog(const std::string& fileName, std::chrono::microseconds bound)
+	: latencyBound(bound)
+{
+#ifdef _WIN32
+	file = _open(fileName.c_str(), _O_RDWR | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+	if (file < 0) { return; }
+	long long size = _lseeki64(file, 0, SEEK_END);
+	long long wholeRecords = size / static_cast<long long>(sizeof(EventRecord));
+	if (size % sizeof(EventRecord) != 0) { _chsize_s(file, wholeRecords * sizeof(EventRecord)); }
+#else
+	file = open(fileName.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+	if (file < 0) { return; }
+	long long size = lseek(file, 0, SEEK_END);
+	long long wholeRecords = size / static_cast<long long>(sizeof(EventRecord));
+	if (size % sizeof(EventRecord) != 0 && ftruncate(file, wholeRecords * sizeof(EventRecord)) != 0) { failed = true; }
+#endif
+
+	//carries the sequence on from the events already in the log
+	nextSequence = static_cast<std::uint64_t>(wholeRecords) + 1;
+	durableSequence = nextSequence - 1;
+
+	//the queues swap places every batch, so both are given room up front for appending not to allocate
+	pending.reserve(RESERVEDEVENTS);
+	writing.reserve(RESERVEDEVENTS);
+	writer = std::thread(&EventLog::writeBatches, this);
+}
+
+//**************************************************
+//Syncs every event still waiting and closes the log
+//**************************************************
+EventLog::~EventLog()
+{
+	if (file < 0) { return; }
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wakeWriter.notify_one();
+	writer.join();
+
+#ifdef _WIN32
+	_close(file);
+#else
+	close(file);
+#endif
+}
+
+//***************************************
+//Returns whether the log file was opened
+//***************************************
+bool EventLog::isOpen() const
+{
+	return file >= 0;
+}
+
+//****************************************************************************
+//Queues an event for the writer thread, which is all a purchase ever waits on
+//****************************************************************************
+void EventLog::append(int type, int item, int quantity, int cents)
+{
+	if (file < 0) { return; }
+
+	EventRecord record;
+	record.time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	record.type = static_cast<std::uint16_t>(type);
+	record.item = static_cast<std::uint16_t>(item);
+	record.quantity = quantity;
+	record.cents = cents;
+
+	bool firstOfBatch;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		record.sequence = nextSequence++;
+		record.checksum = eventChecksum(record);
+		firstOfBatch = pending.empty();
+		if (firstOfBatch) { oldestPending = std::chrono::steady_clock::now(); }
+		pending.push_back(record);
+	}
+
+	//only the first event of a batch needs to start the writer's clock
+	if (firstOfBatch) { wakeWriter.notify_one(); }
+}
+
+//****************************************************************************************
+//Waits until every event appended so far is on disk and returns false if any write failed
+//****************************************************************************************
+bool EventLog::flush()
+{
+	if (file < 0) { return false; }
+
+	std::unique_lock<std::mutex> guard(lock);
+	std::uint64_t last = nextSequence - 1;
+	flushRequested = true;
+	wakeWriter.notify_one();
+	wakeFlushers.wait(guard, [&]() { return durableSequence >= last || failed; });
+
+	return !failed;
+}
+
+//*******************************************************************************************
+//Writes and syncs events in groups, each waiting no longer than the latency bound for others
+//*******************************************************************************************
+void EventLog::writeBatches()
+{
+	std::unique_lock<std::mutex> guard(lock);
+
+	while (true) {
+		wakeWriter.wait(guard, [&]() { return stopping || flushRequested || !pending.empty(); });
+		if (pending.empty() && stopping) { break; }
+
+		//lets more events join the batch until the oldest one has waited as long as it may, counting from when it was appended
+		//so an event queued while the last batch was being synced does not wait a whole bound more after it
+		wakeWriter.wait_until(guard, oldestPending + latencyBound, [&]() { return stopping || flushRequested; });
+		flushRequested = false;
+		if (pending.empty()) {
+			wakeFlushers.notify_all();
+			continue;
+		}
+
+		//writes the batch with the lock released so events can keep being appended meanwhile
+		writing.swap(pending);
+		guard.unlock();
+
+		const char* bytes = reinterpret_cast<const char*>(writing.data());
+		std::size_t remaining = writing.size() * sizeof(EventRecord);
+		bool written = true;
+		while (remaining > 0 && written) {
+#ifdef _WIN32
+			int count = _write(file, bytes, static_cast<unsigned int>(remaining));
+#else
+			long long count = write(file, bytes, remaining);
+#endif
+			written = count > 0;
+			if (written) {
+				bytes += count;
+				remaining -= static_cast<std::size_t>(count);
+			}
+		}
+#ifdef _WIN32
+		written = written && _commit(file) == 0;
+#else
+		written = written && fsync(file) == 0;
+#endif
+
+		guard.lock();
+		if (written)
+			{ durableSequence = writing.back().sequence; }
+		else
+			{ failed = true; }
+		writing.clear();
+		wakeFlushers.notify_all();
+	}
+}
+
+//*************************************
+//Opens a log to be read from the start
+//*************************************
+EventLogReader::EventLogReader(const std::string& fileName)
+	: file(fileName, std::ios::binary), block(BLOCKSIZE)
+{
+}
+
+//***************************************
+//Returns whether the log file was opened
+//***************************************
+bool EventLogReader::isOpen() const
+{
+	return file.is_open();
+}
+
+//*****************************************************************
+//Returns whether reading stopped at a record that failed its check
+//*****************************************************************
+bool EventLogReader::isDamaged() const
+{
+	return damaged;
+}
+
+//***********************************************************************************
+//Reads the next record, returning false at the end of the log or at a damaged record
+//***********************************************************************************
+bool EventLogReader::next(EventRecord& record)
+{
+	if (damaged) { return false; }
+
+	//refills the block once every record in it has been read
+	if (position == filled) {
+		if (!file) { return false; }
+		file.read(reinterpret_cast<char*>(block.data()), BLOCKSIZE * sizeof(EventRecord));
+		filled = static_cast<std::size_t>(file.gcount()) / sizeof(EventRecord);
+		position = 0;
+		if (filled == 0) { return false; }
+	}
+
+	record = block[position++];
+	damaged = record.checksum != eventChecksum(record);
+
+	return !damaged;
+}
+
+#endif
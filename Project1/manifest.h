@@ -0,0 +1,160 @@
+// manifest.h - Antonio Mastroianni
+// Streams the rows of a comma or tab separated restocking manifest, with every field pointing into the buffer it was read into
+
+//NOTE: The manifest is read a buffer at a time, so even a long manifest is held in a fixed amount of memory
+//      Fields are upper cased in place in the buffer, as every command is, instead of being copied out
+
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+//a row of a manifest, whose fields are only valid until the next row is read
+struct ManifestRow
+{
+	const static int MAXFIELDS = 3;
+
+	int line = 0; //the row's line number in the manifest, counting from 1
+	int fieldCount = 0;
+	std::string_view fields[MAXFIELDS]; //every field past the last one given is empty
+	bool tooLong = false; //set when the line did not fit in the buffer, leaving it without fields
+};
+
+//reads a manifest a row at a time, skipping blank lines and comments that start with #
+class ManifestReader
+{
+private:
+
+	const static int BUFFERSIZE = 65536; //the longest line that can be read
+
+	std::ifstream file;
+	std::unique_ptr<char[]> buffer = std::make_unique<char[]>(BUFFERSIZE);
+	std::size_t start = 0; //where the next line starts in the buffer
+	std::size_t end = 0; //where the text read into the buffer ends
+	bool ended = false;
+	int lineNumber = 0;
+
+	bool fill();
+	static std::string_view trim(std::string_view);
+
+public:
+
+	explicit ManifestReader(const std::string&);
+	bool isOpen() const;
+	bool nextRow(ManifestRow&);
+};
+
+
+//***************************************************
+//Opens a manifest to read, without reading any of it
+//***************************************************
+ManifestReader::ManifestReader(const std::string& fileName)
+	: file(fileName, std::ios::binary)
+{
+}
+
+//********************************************
+//Returns whether the manifest could be opened
+//********************************************
+bool ManifestReader::isOpen() const
+{
+	return file.is_open();
+}
+
+//***********************************************************************************************************
+//Moves the part of a line left in the buffer to its front and reads more after it, returning false once full
+//***********************************************************************************************************
+bool ManifestReader::fill()
+{
+	if (start > 0) {
+		std::memmove(buffer.get(), buffer.get() + start, end - start);
+		end -= start;
+		start = 0;
+	}
+	if (end == BUFFERSIZE) { return false; }
+
+	file.read(buffer.get() + end, BUFFERSIZE - end);
+	end += static_cast<std::size_t>(file.gcount());
+	if (!file) { ended = true; }
+
+	return true;
+}
+
+//*****************************************************************
+//Returns a field without the spaces and carriage returns around it
+//*****************************************************************
+std::string_view ManifestReader::trim(std::string_view s)
+{
+	std::size_t first = s.find_first_not_of(" \r");
+	if (first == std::string_view::npos) { return std::string_view(); }
+	std::size_t last = s.find_last_not_of(" \r");
+
+	return s.substr(first, last - first + 1);
+}
+
+//*****************************************************************************
+//Reads the next row that is not blank or a comment, returning false at the end
+//*****************************************************************************
+bool ManifestReader::nextRow(ManifestRow& row)
+{
+	while (true) {
+		char* text = buffer.get();
+		char* lineEnd = static_cast<char*>(std::memchr(text + start, '\n', end - start));
+
+		//reads more until the line ends in the buffer, or the manifest ends without a line break after it
+		if (lineEnd == nullptr && !ended) {
+			if (fill()) { continue; }
+
+			//a line longer than the whole buffer is skipped up to its line break and reported without its fields
+			row = ManifestRow();
+			row.line = ++lineNumber;
+			row.tooLong = true;
+			while (lineEnd == nullptr) {
+				start = end = 0;
+				if (ended) { break; }
+				fill();
+				lineEnd = static_cast<char*>(std::memchr(text, '\n', end));
+			}
+			if (lineEnd != nullptr) { start = static_cast<std::size_t>(lineEnd - text) + 1; }
+			return true;
+		}
+		if (lineEnd == nullptr && start == end) { return false; }
+
+		std::size_t lineStop = (lineEnd != nullptr) ? static_cast<std::size_t>(lineEnd - text) : end;
+		std::string_view line(text + start, lineStop - start);
+		start = (lineEnd != nullptr) ? lineStop + 1 : end;
+		lineNumber++;
+
+		//skips the line if it is blank or a comment
+		std::string_view content = trim(line);
+		std::size_t first = content.find_first_not_of('\t');
+		if (first == std::string_view::npos || content[first] == '#') { continue; }
+
+		//splits the line at every comma or tab, so a manifest may be separated by either
+		row = ManifestRow();
+		row.line = lineNumber;
+		while (true) {
+			std::size_t separator = line.find_first_of(",\t");
+			if (row.fieldCount < ManifestRow::MAXFIELDS) { row.fields[row.fieldCount] = trim(line.substr(0, separator)); }
+			row.fieldCount++;
+			if (separator == std::string_view::npos) { break; }
+			line.remove_prefix(separator + 1);
+		}
+
+		//upper cases the fields in the buffer itself, which the reader owns
+		for (int i = 0; i < row.fieldCount && i < ManifestRow::MAXFIELDS; i++) {
+			char* field = const_cast<char*>(row.fields[i].data());
+			for (std::size_t c = 0; c < row.fields[i].size(); c++)
+				{ field[c] = static_cast<char>(toupper(static_cast<unsigned char>(field[c]))); }
+		}
+
+		return true;
+	}
+}
+
+#endif
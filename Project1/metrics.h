@@ -0,0 +1,186 @@
+// metrics.h - Antonio Mastroianni
+// Times commands with the processor's cycle counter and keeps a log bucketed histogram of how long each one took
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//whether commands are timed, which can be compiled out with VENDING_METRICS=0 so it costs nothing
+#ifndef VENDING_METRICS
+#define VENDING_METRICS 1
+#endif
+
+//**************************************************************************************
+//Reads a clock that only counts up, using the cycle counter where the processor has one
+//**************************************************************************************
+std::uint64_t readCycleCounter()
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+//the cycle counter and steady clock read together when the program started, so cycles can later be converted to time
+struct CycleCounterStart
+{
+	std::uint64_t cycles = readCycleCounter();
+	std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+};
+
+inline const CycleCounterStart cycleCounterStart;
+
+//*********************************************************************************
+//Returns how many cycle counter ticks pass each nanosecond, measured since startup
+//*********************************************************************************
+double cycleCounterRate()
+{
+	//waits until enough time has passed since the program started for the rate to be accurate
+	std::chrono::steady_clock::time_point now;
+	do { now = std::chrono::steady_clock::now(); } while (now - cycleCounterStart.time < std::chrono::milliseconds(10));
+
+	double nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - cycleCounterStart.time).count());
+	return static_cast<double>(readCycleCounter() - cycleCounterStart.cycles) / nanoseconds;
+}
+
+//counts durations in buckets that double in size with every power of two, each split into eight, so any duration is
+//held to within an eighth of its value in a fixed amount of memory
+class LatencyHistogram
+{
+private:
+
+	const static int SUBBUCKETBITS = 3;
+	const static int SUBBUCKETS = 1 << SUBBUCKETBITS;
+	const static int MAXBITS = 40; //durations of 2^40 ticks or more are counted as the largest that fits
+	const static int AMOUNTOFBUCKETS = (MAXBITS - SUBBUCKETBITS + 1) * SUBBUCKETS;
+	std::uint32_t counts[AMOUNTOFBUCKETS] = {};
+	std::uint64_t total = 0;
+	std::uint64_t largest = 0;
+
+	static int highestBit(std::uint64_t);
+	static int bucketOf(std::uint64_t);
+	static std::uint64_t bucketTop(int);
+
+public:
+
+	void record(std::uint64_t);
+	void reset();
+	std::uint64_t count() const;
+	std::uint64_t percentile(double) const;
+	std::uint64_t maximum() const;
+};
+
+const int MAXTIMEDCOMMANDS = 16; //the most commands a machine's command table may hold and have timed
+
+//how long each of a machine's commands took to run, by the command's place in its command records
+struct CommandMetrics
+{
+	LatencyHistogram latency[MAXTIMEDCOMMANDS];
+};
+
+
+//******************************************************
+//Returns the position of the highest set bit of a value
+//******************************************************
+int LatencyHistogram::highestBit(std::uint64_t value)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return static_cast<int>(index);
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+//***********************************
+//Returns the bucket a duration is in
+//***********************************
+int LatencyHistogram::bucketOf(std::uint64_t ticks)
+{
+	//the smallest durations each have a bucket of their own
+	if (ticks < SUBBUCKETS) { return static_cast<int>(ticks); }
+
+	if (ticks >= (std::uint64_t(1) << MAXBITS)) { ticks = (std::uint64_t(1) << MAXBITS) - 1; }
+	int exponent = highestBit(ticks);
+	int subBucket = static_cast<int>(ticks >> (exponent - SUBBUCKETBITS)) & (SUBBUCKETS - 1);
+
+	return (exponent - SUBBUCKETBITS + 1) * SUBBUCKETS + subBucket;
+}
+
+//*******************************************
+//Returns the largest duration a bucket holds
+//*******************************************
+std::uint64_t LatencyHistogram::bucketTop(int bucket)
+{
+	if (bucket < SUBBUCKETS) { return static_cast<std::uint64_t>(bucket); }
+
+	int shift = bucket / SUBBUCKETS - 1;
+	std::uint64_t bottom = static_cast<std::uint64_t>(SUBBUCKETS + bucket % SUBBUCKETS) << shift;
+
+	return bottom + (std::uint64_t(1) << shift) - 1;
+}
+
+//**************************************
+//Counts one duration, measured in ticks
+//**************************************
+void LatencyHistogram::record(std::uint64_t ticks)
+{
+	counts[bucketOf(ticks)]++;
+	total++;
+	if (ticks > largest) { largest = ticks; }
+}
+
+//******************************
+//Forgets every duration counted
+//******************************
+void LatencyHistogram::reset()
+{
+	*this = LatencyHistogram();
+}
+
+//***************************************
+//Returns the amount of durations counted
+//***************************************
+std::uint64_t LatencyHistogram::count() const
+{
+	return total;
+}
+
+//***************************************************************************************************
+//Returns the duration that the given fraction of durations were no longer than, to within its bucket
+//***************************************************************************************************
+std::uint64_t LatencyHistogram::percentile(double fraction) const
+{
+	if (total == 0) { return 0; }
+
+	//finds the bucket holding the duration of the given rank, counting up from the shortest
+	std::uint64_t rank = static_cast<std::uint64_t>(fraction * total);
+	if (rank < fraction * total || rank < 1) { rank++; }
+	std::uint64_t seen = 0;
+	for (int bucket = 0; bucket < AMOUNTOFBUCKETS; bucket++) {
+		seen += counts[bucket];
+		if (seen >= rank) { return bucketTop(bucket) < largest ? bucketTop(bucket) : largest; }
+	}
+
+	return largest;
+}
+
+//************************************
+//Returns the longest duration counted
+//************************************
+std::uint64_t LatencyHistogram::maximum() const
+{
+	return largest;
+}
+
+#endif
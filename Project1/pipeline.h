@@ -0,0 +1,414 @@
+// pipeline.h - Antonio Mastroianni
+// Reads a script and writes its output on threads of their own, passing text to and from the machine through lock-free rings
+
+//NOTE: Each ring has exactly one thread putting slots in and one taking them out, so neither ever takes a lock
+//      A thread only sleeps when its ring is full or empty, and is woken through the ring's atomic counters
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+
+//a fixed size block of text passed from one thread to another
+struct TextSlot
+{
+	const static int CAPACITY = 16384;
+
+	char text[CAPACITY];
+	int length = 0;
+	bool continues = false; //set when the slot ends partway through a line that goes on in the next slot
+	bool last = false; //set on the slot that ends the stream
+};
+
+//a ring of slots allocated once, filled by one thread and emptied by another without locks
+template <typename Slot, int SLOTS>
+class SpscRing
+{
+private:
+
+	static_assert((SLOTS & (SLOTS - 1)) == 0, "the counters wrap around, so the amount of slots must be a power of two");
+
+	std::unique_ptr<Slot[]> slots = std::make_unique<Slot[]>(SLOTS);
+	alignas(64) std::atomic<std::uint32_t> taken{ 0 }; //how many slots the consumer has finished with, only it changes this
+	alignas(64) std::atomic<std::uint32_t> filled{ 0 }; //how many slots the producer has filled, only it changes this
+	alignas(64) std::atomic<bool> abandoned{ false };
+
+public:
+
+	Slot* claim();
+	void publish();
+	Slot* take();
+	std::uint32_t available() const;
+	void release();
+	void abandon();
+};
+
+const int PIPELINESLOTS = 8;
+using TextRing = SpscRing<TextSlot, PIPELINESLOTS>;
+
+//reads a script on its own thread, in slots that only end partway through a line if that line fills a whole slot
+class LineReader
+{
+private:
+
+	const static int MINIMUMROOM = 1024; //a slot with less room than this left is passed on instead of splitting the next line
+
+	std::shared_ptr<TextRing> ring = std::make_shared<TextRing>(); //shared with the thread, which may outlive the reader
+	std::thread thread;
+	bool readsStandardInput;
+	TextSlot* slot = nullptr; //the slot lines are being taken from
+	std::string_view remaining; //the part of the slot that has not been taken yet
+	std::string longLine; //a line that spans several slots, joined back together
+	bool longLineTaken = false;
+	bool ended = false;
+
+	static void read(std::istream&, TextRing&);
+
+public:
+
+	explicit LineReader(std::istream&);
+	~LineReader();
+	LineReader(const LineReader&) = delete;
+	LineReader& operator=(const LineReader&) = delete;
+	bool nextLine(std::string_view&);
+	bool mayWaitForInput() const;
+};
+
+//a stream buffer whose text is written to another stream buffer on its own thread
+class OutputWriter : public std::streambuf
+{
+private:
+
+	TextRing ring;
+	std::thread thread;
+	TextSlot* slot = nullptr; //the slot being written into
+	bool finished = false;
+
+	static void write(std::streambuf&, TextRing&);
+	void passOn(bool);
+
+protected:
+
+	int overflow(int) override;
+	int sync() override;
+
+public:
+
+	explicit OutputWriter(std::streambuf&);
+	~OutputWriter();
+	OutputWriter(const OutputWriter&) = delete;
+	OutputWriter& operator=(const OutputWriter&) = delete;
+	void finish();
+};
+
+
+//*********************************************************************************************
+//Returns an empty slot to fill, waiting while the ring is full, or nullptr if it was abandoned
+//*********************************************************************************************
+template <typename Slot, int SLOTS>
+Slot* SpscRing<Slot, SLOTS>::claim()
+{
+	std::uint32_t next = filled.load(std::memory_order_relaxed);
+	std::uint32_t done;
+
+	//sleeps until the consumer finishes with a slot
+	while (next - (done = taken.load(std::memory_order_acquire)) == SLOTS)
+		{ taken.wait(done, std::memory_order_acquire); }
+
+	if (abandoned.load(std::memory_order_acquire)) { return nullptr; }
+	return &slots[next % SLOTS];
+}
+
+//***********************************************************
+//Passes the slot that was claimed on to the consuming thread
+//***********************************************************
+template <typename Slot, int SLOTS>
+void SpscRing<Slot, SLOTS>::publish()
+{
+	filled.store(filled.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	filled.notify_one();
+}
+
+//*************************************************************
+//Returns the next filled slot, waiting while the ring is empty
+//*************************************************************
+template <typename Slot, int SLOTS>
+Slot* SpscRing<Slot, SLOTS>::take()
+{
+	std::uint32_t next = taken.load(std::memory_order_relaxed);
+	std::uint32_t ready;
+
+	//sleeps until the producer fills a slot
+	while ((ready = filled.load(std::memory_order_acquire)) == next)
+		{ filled.wait(ready, std::memory_order_acquire); }
+
+	return &slots[next % SLOTS];
+}
+
+//********************************************************************
+//Returns how many filled slots the consumer has not yet finished with
+//********************************************************************
+template <typename Slot, int SLOTS>
+std::uint32_t SpscRing<Slot, SLOTS>::available() const
+{
+	return filled.load(std::memory_order_acquire) - taken.load(std::memory_order_relaxed);
+}
+
+//****************************************************************
+//Gives the slot that was taken back to the producer to fill again
+//****************************************************************
+template <typename Slot, int SLOTS>
+void SpscRing<Slot, SLOTS>::release()
+{
+	taken.store(taken.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	taken.notify_one();
+}
+
+//**************************************************************************************
+//Tells the producer that no more slots will be taken, waking it if it is waiting on one
+//**************************************************************************************
+template <typename Slot, int SLOTS>
+void SpscRing<Slot, SLOTS>::abandon()
+{
+	abandoned.store(true, std::memory_order_release);
+
+	//the producer only wakes when the count it waits on changes, and nothing is read from the ring anymore
+	taken.fetch_add(1, std::memory_order_release);
+	taken.notify_one();
+}
+
+//******************************************************************
+//Starts reading a script, or standard input, on a thread of its own
+//******************************************************************
+LineReader::LineReader(std::istream& script)
+	: readsStandardInput(&script == &std::cin)
+{
+	thread = std::thread([&script, shared = ring]() { read(script, *shared); });
+}
+
+//******************************************************************************************
+//Stops the reading thread, leaving it behind if it may be waiting on input that never comes
+//******************************************************************************************
+LineReader::~LineReader()
+{
+	if (ended) {
+		thread.join();
+		return;
+	}
+
+	ring->abandon();
+
+	//a file always finishes reading, but standard input may be a terminal or pipe that stays open, so that thread is left to
+	//end with the program and keeps the ring alive through its share of it
+	if (readsStandardInput) { thread.detach(); }
+	else { thread.join(); }
+}
+
+//******************************************************************
+//Fills slots with lines from a script until it ends or is abandoned
+//******************************************************************
+void LineReader::read(std::istream& script, TextRing& ring)
+{
+	bool ended = false;
+
+	while (!ended) {
+		TextSlot* slot = ring.claim();
+		if (slot == nullptr) { return; }
+		slot->length = 0;
+		slot->continues = false;
+		slot->last = false;
+
+		//adds whole lines until the slot is nearly full or the script has nothing more ready to read
+		while (true) {
+			std::streamsize room = TextSlot::CAPACITY - slot->length;
+			script.getline(slot->text + slot->length, room);
+			int count = static_cast<int>(script.gcount());
+
+			//a line ending the script without a line break still counts as a line, and a script that can no longer be read ends
+			if (script.eof() || script.bad()) {
+				slot->length += count;
+				slot->last = ended = true;
+				break;
+			}
+
+			//a line too long for the room left is continued in the next slot
+			if (script.fail()) {
+				script.clear();
+				slot->length += count;
+				slot->continues = true;
+				break;
+			}
+
+			//getline counts the line break it took out but does not store it, so it is put back in place
+			slot->length += count;
+			slot->text[slot->length - 1] = '\n';
+
+			if (TextSlot::CAPACITY - slot->length < MINIMUMROOM || script.rdbuf()->in_avail() <= 0) { break; }
+		}
+
+		ring.publish();
+	}
+}
+
+//**********************************************************************************************************
+//Takes the next line of the script, waiting for it if it has not been read yet, or returns false at its end
+//**********************************************************************************************************
+bool LineReader::nextLine(std::string_view& line)
+{
+	//the line taken before is no longer used once the next one is asked for
+	if (longLineTaken) {
+		longLine.clear();
+		longLineTaken = false;
+	}
+
+	while (true) {
+		if (!remaining.empty()) {
+			std::size_t end = remaining.find('\n');
+			std::string_view piece = remaining.substr(0, end);
+			remaining.remove_prefix(end == std::string_view::npos ? remaining.size() : end + 1);
+
+			//a line that goes on in the next slot is kept until the rest of it arrives
+			if (end == std::string_view::npos && slot->continues) { longLine.append(piece); }
+			else if (!longLine.empty()) {
+				longLine.append(piece);
+				line = longLine;
+				longLineTaken = true;
+				return true;
+			}
+			else {
+				line = piece;
+				return true;
+			}
+		}
+
+		//moves on to the next slot once every line of this one has been run
+		if (slot != nullptr) {
+			bool last = slot->last;
+			ring->release();
+			slot = nullptr;
+			if (last) {
+				ended = true;
+
+				//a line that exactly filled the slot before an empty last one never had its line break, but is still a line
+				if (!longLine.empty()) {
+					line = longLine;
+					longLineTaken = true;
+					return true;
+				}
+				return false;
+			}
+		}
+		if (ended) { return false; }
+
+		slot = ring->take();
+		remaining = std::string_view(slot->text, slot->length);
+	}
+}
+
+//********************************************************************************************************
+//Returns whether taking the next line may wait on standard input for a line that has not been written yet
+//********************************************************************************************************
+bool LineReader::mayWaitForInput() const
+{
+	//a file is read far ahead of the machine, so only standard input, which may be a pipe or terminal, is ever waited on
+	if (!readsStandardInput || !remaining.empty()) { return false; }
+
+	//the slot lines are being taken from is still in the ring until it is released
+	return ring->available() <= (slot != nullptr ? 1u : 0u);
+}
+
+//********************************************************************
+//Starts writing everything put into the buffer to another on a thread
+//********************************************************************
+OutputWriter::OutputWriter(std::streambuf& destination)
+{
+	slot = ring.claim();
+	slot->length = 0;
+	slot->last = false;
+	setp(slot->text, slot->text + TextSlot::CAPACITY);
+	thread = std::thread(write, std::ref(destination), std::ref(ring));
+}
+
+//***********************************************************
+//Writes whatever is left and waits for the writing to finish
+//***********************************************************
+OutputWriter::~OutputWriter()
+{
+	finish();
+}
+
+//**************************************************************************************
+//Passes the slot being written into on to the writing thread and starts on an empty one
+//**************************************************************************************
+void OutputWriter::passOn(bool last)
+{
+	slot->length = static_cast<int>(pptr() - pbase());
+	slot->last = last;
+	ring.publish();
+	if (last) { return; }
+
+	slot = ring.claim();
+	slot->length = 0;
+	slot->last = false;
+	setp(slot->text, slot->text + TextSlot::CAPACITY);
+}
+
+//****************************************************************
+//Passes on a full slot, then puts the character into the next one
+//****************************************************************
+int OutputWriter::overflow(int c)
+{
+	passOn(false);
+	if (c != traits_type::eof()) { sputc(static_cast<char>(c)); }
+
+	return traits_type::not_eof(c);
+}
+
+//***********************************************************
+//Passes on what has been written so far so it is written out
+//***********************************************************
+int OutputWriter::sync()
+{
+	if (pptr() > pbase()) { passOn(false); }
+
+	return 0;
+}
+
+//***************************************************************************
+//Passes on the last of the output and waits until all of it has been written
+//***************************************************************************
+void OutputWriter::finish()
+{
+	if (finished) { return; }
+	finished = true;
+
+	passOn(true);
+	thread.join();
+}
+
+//***************************************************************************
+//Writes each slot passed on to the destination until the last one is written
+//***************************************************************************
+void OutputWriter::write(std::streambuf& destination, TextRing& ring)
+{
+	bool last = false;
+
+	while (!last) {
+		TextSlot* slot = ring.take();
+		destination.sputn(slot->text, slot->length);
+		last = slot->last;
+		ring.release();
+
+		//flushes whenever it has caught up, so output is seen while the script is still being run
+		if (last || ring.available() == 0) { destination.pubsync(); }
+	}
+}
+
+#endif
@@ -0,0 +1,172 @@
+// pool.h - Antonio Mastroianni
+// Hands out objects and fixed size blocks of memory carved from larger chunks, and keeps whatever is given back for reuse instead of freeing it
+
+//NOTE: Nothing here is thread safe, every pool is meant to be used by the one thread that owns it, such as the server's event loop
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+//fixed size blocks of memory, allocated from the heap a chunk at a time and never returned to it until the pool is destroyed
+class BlockPool
+{
+private:
+
+	const static int BLOCKSPERCHUNK = 64;
+
+	//a block that is not in use holds the next block that is not in use
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	std::size_t size; //the size of every block, rounded up so each block is aligned for any type
+	std::vector<std::unique_ptr<unsigned char[]>> chunks;
+	FreeBlock* freeBlocks = nullptr;
+
+	void addChunk();
+
+public:
+
+	explicit BlockPool(std::size_t);
+	BlockPool(const BlockPool&) = delete;
+	BlockPool& operator=(const BlockPool&) = delete;
+	void* allocate();
+	void release(void*);
+	std::size_t blockSize() const;
+};
+
+//objects made in a block pool, where an object given back stays as it was left so it can be handed out again with the
+//memory it has already grown, such as the buffers of a session
+template <typename T>
+class ObjectPool
+{
+private:
+
+	BlockPool blocks{ sizeof(T) };
+	std::vector<T*> made; //every object the pool has made, so they can all be destroyed with it
+	std::vector<T*> idle; //the objects that were given back and can be handed out again
+
+public:
+
+	ObjectPool() = default;
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator=(const ObjectPool&) = delete;
+	~ObjectPool();
+	T* reuse();
+	template <typename... Arguments>
+	T* make(Arguments&&...);
+	void release(T*);
+};
+
+
+//***************************************************************************
+//Creates a pool of blocks of at least the given size, without allocating any
+//***************************************************************************
+BlockPool::BlockPool(std::size_t minimumSize)
+{
+	const std::size_t alignment = alignof(std::max_align_t);
+	size = (std::max(minimumSize, sizeof(FreeBlock)) + alignment - 1) / alignment * alignment;
+}
+
+//**********************************************************************
+//Allocates another chunk and adds each of its blocks to the free blocks
+//**********************************************************************
+void BlockPool::addChunk()
+{
+	//memory from new[] is aligned for any type, and every block size is a multiple of that alignment
+	chunks.push_back(std::make_unique<unsigned char[]>(size * BLOCKSPERCHUNK));
+	unsigned char* chunk = chunks.back().get();
+
+	for (int i = BLOCKSPERCHUNK - 1; i >= 0; i--)
+		{ release(chunk + i * size); }
+}
+
+//***********************************************************************
+//Returns a block that is not in use, allocating a chunk only if none are
+//***********************************************************************
+void* BlockPool::allocate()
+{
+	if (freeBlocks == nullptr) { addChunk(); }
+
+	FreeBlock* block = freeBlocks;
+	freeBlocks = block->next;
+	return block;
+}
+
+//***********************************************
+//Takes back a block so it can be allocated again
+//***********************************************
+void BlockPool::release(void* memory)
+{
+	FreeBlock* block = static_cast<FreeBlock*>(memory);
+	block->next = freeBlocks;
+	freeBlocks = block;
+}
+
+//************************************
+//Returns the size of every block held
+//************************************
+std::size_t BlockPool::blockSize() const
+{
+	return size;
+}
+
+//**************************************************
+//Destroys every object the pool made, in use or not
+//**************************************************
+template <typename T>
+ObjectPool<T>::~ObjectPool()
+{
+	for (T* object : made)
+		{ object->~T(); }
+}
+
+//*******************************************************************************************
+//Returns an object that was given back, exactly as it was left, or nullptr if there are none
+//*******************************************************************************************
+template <typename T>
+T* ObjectPool<T>::reuse()
+{
+	if (idle.empty()) { return nullptr; }
+
+	T* object = idle.back();
+	idle.pop_back();
+	return object;
+}
+
+//********************************************************
+//Makes a new object in one of the pool's blocks of memory
+//********************************************************
+template <typename T>
+template <typename... Arguments>
+T* ObjectPool<T>::make(Arguments&&... arguments)
+{
+	static_assert(alignof(T) <= alignof(std::max_align_t), "a block pool only aligns its blocks for the standard types");
+
+	void* memory = blocks.allocate();
+	T* object = new (memory) T(std::forward<Arguments>(arguments)...);
+	made.push_back(object);
+
+	//makes room for every object to be given back, so releasing one never allocates
+	idle.reserve(made.capacity());
+
+	return object;
+}
+
+//*************************************************************************
+//Takes back an object so it can be handed out again, without destroying it
+//*************************************************************************
+template <typename T>
+void ObjectPool<T>::release(T* object)
+{
+	idle.push_back(object);
+}
+
+#endif
@@ -0,0 +1,108 @@
+// report.h - Antonio Mastroianni
+// Lays out a report as plain text in a reusable buffer so it can be written out all at once
+
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <charconv>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+//a block of text built up without iostream formatting, whose memory is kept from one report to the next
+class ReportBuffer
+{
+private:
+
+	std::string text;
+
+public:
+
+	void clear();
+	void reserve(std::size_t);
+	void append(std::string_view);
+	void appendPadded(std::string_view, int);
+	void appendNumber(long long);
+	void appendMoney(long long);
+	void appendHundredths(long long);
+	void writeTo(std::ostream&) const;
+};
+
+
+//***************************************************************
+//Empties the buffer while keeping its memory for the next report
+//***************************************************************
+void ReportBuffer::clear()
+{
+	text.clear();
+}
+
+//*************************************************************
+//Makes sure the buffer can hold the given amount of characters
+//*************************************************************
+void ReportBuffer::reserve(std::size_t length)
+{
+	if (text.capacity() < length) { text.reserve(length); }
+}
+
+//***********************
+//Adds text to the buffer
+//***********************
+void ReportBuffer::append(std::string_view s)
+{
+	text.append(s.data(), s.size());
+}
+
+//*******************************************************************************
+//Adds text followed by enough spaces to fill the given width, as std::setw would
+//*******************************************************************************
+void ReportBuffer::appendPadded(std::string_view s, int width)
+{
+	append(s);
+	if (static_cast<int>(s.size()) < width) { text.append(width - s.size(), ' '); }
+}
+
+//**************************************
+//Adds a whole number written in decimal
+//**************************************
+void ReportBuffer::appendNumber(long long number)
+{
+	char digits[24];
+	std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), number);
+	text.append(digits, result.ptr - digits);
+}
+
+//*******************************************************************
+//Adds an amount given in cents as whole units and two decimal places
+//*******************************************************************
+void ReportBuffer::appendMoney(long long cents)
+{
+	appendHundredths(cents);
+}
+
+//************************************************************************
+//Adds a number given in hundredths as a whole part and two decimal places
+//************************************************************************
+void ReportBuffer::appendHundredths(long long hundredths)
+{
+	if (hundredths < 0) {
+		text.push_back('-');
+		hundredths = -hundredths;
+	}
+
+	appendNumber(hundredths / 100);
+	text.push_back('.');
+	text.push_back(static_cast<char>('0' + hundredths % 100 / 10));
+	text.push_back(static_cast<char>('0' + hundredths % 10));
+}
+
+//*******************************************
+//Writes the whole buffer to a stream at once
+//*******************************************
+void ReportBuffer::writeTo(std::ostream& stream) const
+{
+	stream.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+#endif
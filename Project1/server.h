@@ -0,0 +1,330 @@
+// server.h - Antonio Mastroianni
+// Serves the vending machine to many clients at once over a Unix domain socket, with one thread waiting on them all through epoll
+
+//NOTE: Each client is a coroutine session (see session.h) running its commands on one machine shared by every client
+//      Sessions come from a pool and are kept when their clients leave, so a new client usually costs no heap allocations
+//      Every command's response ends with a line of OK, or ERROR if the command failed, so a client knows where it ends
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "pool.h"
+#include "session.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+//listens on a Unix domain socket and runs the commands of every client connected to it on a single thread
+class CommandServer
+{
+private:
+
+	const static int MAXLINELENGTH = 4096; //a client sending a longer line is disconnected
+	const static int MAXEVENTS = 64;
+	static int wakeupPipe[2]; //written to by the signal handler so the event loop notices it should stop
+
+	std::string socketName;
+	const Catalog& catalog;
+	EventLog* eventLog;
+	VendingMachine machine; //the stock, money and change table every session sells from
+	CommandMetrics metrics;
+	SalesAnalytics analytics; //every session's sales and deposits, counted together
+	StockAlerts alerts; //the shared inventory's low stock thresholds
+	ObjectPool<VendingMachine::Deposit> depositPool; //every deposit made, whether a purchase is using it or not
+	ObjectPool<Session> sessionPool; //every session made, whether in use or waiting for another client
+	std::vector<Session*> sessions; //the sessions of the clients connected now
+	SessionScheduler scheduler;
+	int listener = -1;
+	int epoll = -1;
+
+	static void requestStop(int);
+	bool open();
+	void acceptClients();
+	void readFrom(Session&);
+	void writeTo(Session&);
+	void settle(Session&);
+	void updateEvents(Session&);
+	void closeSession(Session&);
+
+public:
+
+	CommandServer(std::string, const Catalog&, EventLog*);
+	~CommandServer();
+	CommandServer(const CommandServer&) = delete;
+	CommandServer& operator=(const CommandServer&) = delete;
+	int run();
+};
+
+int CommandServer::wakeupPipe[2] = { -1, -1 };
+
+
+//********************************************************************************
+//Creates a server for the given socket file, selling the catalog from one machine
+//********************************************************************************
+CommandServer::CommandServer(std::string name, const Catalog& products, EventLog* log)
+	: socketName(std::move(name)), catalog(products), eventLog(log), machine(std::cerr),
+	analytics(products.size(), denominationCount<VendingMachine::CurrencyType>()),
+	alerts(products.size(), coinCount<VendingMachine::CurrencyType>(), denominationCount<VendingMachine::CurrencyType>())
+{
+	machine.setCatalog(catalog);
+	machine.setEventLog(eventLog);
+	machine.setMetrics(&metrics);
+	machine.setAnalytics(&analytics);
+	machine.setAlerts(&alerts);
+
+	//reports each item that goes low or is restocked as it happens, so the inventory need not be polled with STATUS
+	alerts.subscribe([this](const StockAlert& alert) {
+		std::cerr << stockItemName<VendingMachine::CurrencyType>(catalog, alert.item)
+			<< (alert.low ? " went low with " : " was restocked to ") << alert.count << (alert.low ? " left\n" : "\n");
+	});
+}
+
+//****************************************************
+//Disconnects every client and removes the socket file
+//****************************************************
+CommandServer::~CommandServer()
+{
+	while (!sessions.empty())
+		{ closeSession(*sessions.back()); }
+
+	if (listener >= 0) {
+		close(listener);
+		unlink(socketName.c_str());
+	}
+	if (epoll >= 0) { close(epoll); }
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	for (int& end : wakeupPipe) {
+		if (end >= 0) { close(end); }
+		end = -1;
+	}
+}
+
+//**************************************************************
+//Wakes the event loop so it stops, called when a signal arrives
+//**************************************************************
+void CommandServer::requestStop(int)
+{
+	char wakeup = 0;
+	if (write(wakeupPipe[1], &wakeup, 1) < 0) { return; }
+}
+
+//********************************************************************************
+//Creates the listening socket, the epoll instance and the pipe signals wake it by
+//********************************************************************************
+bool CommandServer::open()
+{
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (socketName.size() >= sizeof(address.sun_path)) {
+		std::cerr << socketName << " is too long for a socket name\n";
+		return false;
+	}
+	std::memcpy(address.sun_path, socketName.c_str(), socketName.size() + 1);
+
+	//replaces a socket file left behind by a server that did not shut down cleanly
+	unlink(socketName.c_str());
+
+	listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0) {
+		std::cerr << "Unable to listen on " << socketName << ": " << std::strerror(errno) << '\n';
+		return false;
+	}
+
+	epoll = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll < 0 || pipe2(wakeupPipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+		std::cerr << "Unable to start the event loop: " << std::strerror(errno) << '\n';
+		return false;
+	}
+
+	//the listener and the wakeup pipe are told apart from sessions by pointing at themselves instead
+	epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.ptr = &listener;
+	epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+	event.data.ptr = wakeupPipe;
+	epoll_ctl(epoll, EPOLL_CTL_ADD, wakeupPipe[0], &event);
+
+	//stops the server cleanly on Ctrl+C or when it is asked to terminate
+	struct sigaction action = {};
+	action.sa_handler = requestStop;
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+
+	return true;
+}
+
+//***********************************************************************************
+//Runs the event loop until the server is stopped and returns the program's exit code
+//***********************************************************************************
+int CommandServer::run()
+{
+	if (!open()) { return 2; }
+	std::cerr << "Serving on " << socketName << '\n';
+
+	epoll_event events[MAXEVENTS];
+	bool stopping = false;
+
+	while (!stopping) {
+		int ready = epoll_wait(epoll, events, MAXEVENTS, -1);
+		if (ready < 0) {
+			if (errno == EINTR) { continue; }
+			std::cerr << "The event loop failed: " << std::strerror(errno) << '\n';
+			return 1;
+		}
+
+		for (int i = 0; i < ready; i++) {
+			if (events[i].data.ptr == &listener) { acceptClients(); }
+			else if (events[i].data.ptr == wakeupPipe) { stopping = true; }
+			else {
+				Session& session = *static_cast<Session*>(events[i].data.ptr);
+
+				//a hung up client may still have lines left to read, so reading comes first
+				if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) { readFrom(session); }
+				settle(session);
+			}
+		}
+
+		//resumes every session that now has a line to run, each running until it waits for another
+		while (Session* session = scheduler.next()) {
+			session->task.resume();
+			settle(*session);
+		}
+	}
+
+	std::cerr << "Stopped serving on " << socketName << '\n';
+	return 0;
+}
+
+//****************************************************************
+//Accepts every client waiting to connect and gives each a session
+//****************************************************************
+void CommandServer::acceptClients()
+{
+	while (true) {
+		int client = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (client < 0) { return; }
+
+		//reuses a session left by an earlier client when there is one, whose coroutine starts at once and waits for the first line
+		Session* session = sessionPool.reuse();
+		if (session != nullptr) { session->reopen(client); }
+		else { session = sessionPool.make(client, machine, depositPool); }
+		session->place = sessions.size();
+
+		epoll_event event = {};
+		event.events = EPOLLIN;
+		event.data.ptr = session;
+		if (epoll_ctl(epoll, EPOLL_CTL_ADD, client, &event) != 0) {
+			close(client);
+			sessionPool.release(session);
+			continue;
+		}
+		session->events = EPOLLIN;
+		sessions.push_back(session);
+	}
+}
+
+//***********************************************************
+//Reads what a client has sent into its session's line buffer
+//***********************************************************
+void CommandServer::readFrom(Session& session)
+{
+	char chunk[4096];
+	ssize_t count = read(session.socket, chunk, sizeof(chunk));
+
+	if (count > 0) { session.receive(chunk, static_cast<std::size_t>(count)); }
+	else if (count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) { session.inputEnded = true; }
+
+	//a client that never ends its line would otherwise be buffered without limit
+	std::size_t lastLineEnd = session.received.rfind('\n');
+	std::size_t partLine = session.received.size() - (lastLineEnd == std::string::npos ? 0 : lastLineEnd + 1);
+	if (partLine > MAXLINELENGTH) {
+		session.output << "Line too long\nERROR\n";
+		session.received.resize(lastLineEnd == std::string::npos ? 0 : lastLineEnd + 1);
+		session.inputEnded = true;
+	}
+}
+
+//****************************************************************************
+//Writes as much of a session's output as the client will take without waiting
+//****************************************************************************
+void CommandServer::writeTo(Session& session)
+{
+	ConnectionBuffer& sent = session.sent;
+
+	while (sent.unwritten() > 0) {
+		ssize_t count = send(session.socket, sent.pending.data() + sent.written, sent.unwritten(), MSG_NOSIGNAL);
+		if (count > 0) { sent.written += static_cast<std::size_t>(count); }
+		else if (count < 0 && errno == EINTR) { continue; }
+		else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { return; }
+		else {
+			//the client has gone, so nothing more can be sent to it or read from it
+			sent.written = sent.pending.size();
+			session.inputEnded = true;
+		}
+	}
+
+	sent.pending.clear();
+	sent.written = 0;
+}
+
+//***************************************************************************************************
+//Writes a session's output and then resumes it, closes it or waits on its socket, whichever it needs
+//***************************************************************************************************
+void CommandServer::settle(Session& session)
+{
+	writeTo(session);
+
+	if (session.task.isDone() && session.sent.unwritten() == 0) { closeSession(session); }
+	else {
+		if (session.waiting && session.canResume()) { scheduler.schedule(session); }
+		updateEvents(session);
+	}
+}
+
+//*********************************************************************************
+//Waits for a client to send more, for room to write to it or for both, as it needs
+//*********************************************************************************
+void CommandServer::updateEvents(Session& session)
+{
+	unsigned int wanted = 0;
+	if (!session.inputEnded && !session.task.isDone() && session.sent.unwritten() < Session::MAXUNWRITTEN) { wanted |= EPOLLIN; }
+	if (session.sent.unwritten() > 0) { wanted |= EPOLLOUT; }
+
+	if (wanted != session.events) {
+		epoll_event event = {};
+		event.events = wanted;
+		event.data.ptr = &session;
+		epoll_ctl(epoll, EPOLL_CTL_MOD, session.socket, &event);
+		session.events = wanted;
+	}
+}
+
+//************************************************************
+//Disconnects a client and removes its session from the server
+//************************************************************
+void CommandServer::closeSession(Session& session)
+{
+	//any money a client left deposited goes back to it, as the RETURN command would, which also gives back its deposit
+	if (session.hasDeposit()) { session.runLine("RETURN"); }
+
+	epoll_ctl(epoll, EPOLL_CTL_DEL, session.socket, nullptr);
+	close(session.socket);
+
+	//moves the last session into the closed one's place and keeps the closed one for the next client
+	std::size_t place = session.place;
+	std::swap(sessions[place], sessions.back());
+	sessions[place]->place = place;
+	sessions.pop_back();
+	sessionPool.release(&session);
+}
+
+#endif
@@ -0,0 +1,339 @@
+// session.h - Antonio Mastroianni
+// Runs each customer's commands as a coroutine that suspends while it waits for the customer's next line
+
+//NOTE: Needs C++20 for its coroutines
+//      Every session runs its commands on one shared machine, keeping only its connection, its mode and the deposit of the
+//      purchase it is making, which comes from a pool and goes back to it once COLA or RETURN leaves it empty
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "vending.h"
+#include "pool.h"
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <string>
+#include <string_view>
+
+//collects everything a session's machine displays until it can be written back to the customer
+class ConnectionBuffer : public std::streambuf
+{
+public:
+
+	std::string pending; //displayed but not yet written to the customer
+	std::size_t written = 0; //how much of pending the customer has already been sent
+
+	std::size_t unwritten() const { return pending.size() - written; }
+
+protected:
+
+	int overflow(int c) override
+	{
+		if (c != traits_type::eof()) { pending.push_back(static_cast<char>(c)); }
+		return c;
+	}
+
+	std::streamsize xsputn(const char* s, std::streamsize n) override
+	{
+		pending.append(s, static_cast<std::size_t>(n));
+		return n;
+	}
+};
+
+//owns a session's coroutine, which runs as soon as it is created until it first waits, and stays suspended once it finishes so its end can be seen
+class SessionTask
+{
+public:
+
+	struct promise_type
+	{
+		SessionTask get_return_object() { return SessionTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+		static void* operator new(std::size_t);
+		static void operator delete(void*, std::size_t);
+	};
+
+	SessionTask() = default;
+	explicit SessionTask(std::coroutine_handle<promise_type> coroutine) : handle(coroutine) {}
+	SessionTask(SessionTask&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+	SessionTask& operator=(SessionTask&&) noexcept;
+	SessionTask(const SessionTask&) = delete;
+	SessionTask& operator=(const SessionTask&) = delete;
+	~SessionTask();
+	bool isDone() const;
+	void resume();
+
+private:
+
+	const static int POOLEDFRAMESIZE = 512; //coroutines larger than this, which no session's should be, come from the heap instead
+
+	std::coroutine_handle<promise_type> handle;
+
+	static BlockPool& framePool();
+};
+
+//one customer: the lines they have sent, the output waiting for them and the deposit and mode their commands run with
+struct Session
+{
+	const static int MAXUNWRITTEN = 1 << 16; //a session with this much output unread waits for the customer to catch up
+
+	int socket; //the connection the session is served over
+	std::size_t place = 0; //where the session is in its server's list, so it can be removed without searching
+	unsigned int events = 0; //the epoll events the server is waiting on for the session
+	std::string received; //what the customer has sent, from the line being run onward
+	std::size_t nextLine = 0; //where the next line to run starts in received
+	ConnectionBuffer sent;
+	std::ostream output;
+	VendingMachine& machine; //the machine every session runs its commands on
+	ObjectPool<VendingMachine::Deposit>& deposits; //where the deposit of each purchase is taken from
+	VendingMachine::Customer customer; //starts locked, so the service commands wait until the customer unlocks the machine
+	bool inputEnded = false; //set once the customer can send nothing more, such as after hanging up
+	bool waiting = false; //set while the coroutine is suspended waiting for a line
+	SessionTask task;
+
+	Session(int, VendingMachine&, ObjectPool<VendingMachine::Deposit>&);
+	void reopen(int);
+	void receive(const char*, std::size_t);
+	bool canResume() const;
+	bool takeLine(std::string_view&);
+	bool runLine(std::string_view);
+	bool hasDeposit() const;
+};
+
+//suspends a session's coroutine until its customer has sent a whole line, resuming with false if none will come
+class LineAwaiter
+{
+private:
+
+	Session& session;
+	std::string_view& line;
+
+public:
+
+	LineAwaiter(Session& customer, std::string_view& nextLine) : session(customer), line(nextLine) {}
+	bool await_ready() const { return session.canResume(); }
+	void await_suspend(std::coroutine_handle<>) { session.waiting = true; }
+	bool await_resume() { session.waiting = false; return session.takeLine(line); }
+};
+
+//resumes sessions that have a line to run, one at a time on the thread that runs it
+class SessionScheduler
+{
+private:
+
+	std::deque<Session*> ready;
+
+public:
+
+	void schedule(Session&);
+	Session* next();
+};
+
+SessionTask runSession(Session&);
+
+
+//*******************************************************************************
+//Returns the pool every session's coroutine is allocated from, made on first use
+//*******************************************************************************
+BlockPool& SessionTask::framePool()
+{
+	static BlockPool pool(POOLEDFRAMESIZE);
+	return pool;
+}
+
+//*******************************************************************************************
+//Allocates a session's coroutine from the frame pool, so a new session need not use the heap
+//*******************************************************************************************
+void* SessionTask::promise_type::operator new(std::size_t size)
+{
+	if (size > POOLEDFRAMESIZE) { return ::operator new(size); }
+	return framePool().allocate();
+}
+
+//************************************************************************
+//Gives a finished or abandoned coroutine's memory back where it came from
+//************************************************************************
+void SessionTask::promise_type::operator delete(void* memory, std::size_t size)
+{
+	if (size > POOLEDFRAMESIZE) { ::operator delete(memory); }
+	else { framePool().release(memory); }
+}
+
+//************************************************************
+//Takes over another coroutine, destroying the one held before
+//************************************************************
+SessionTask& SessionTask::operator=(SessionTask&& other) noexcept
+{
+	if (this != &other) {
+		if (handle) { handle.destroy(); }
+		handle = other.handle;
+		other.handle = nullptr;
+	}
+
+	return *this;
+}
+
+//*****************************************************************
+//Destroys the coroutine, whether it finished or is still suspended
+//*****************************************************************
+SessionTask::~SessionTask()
+{
+	if (handle) { handle.destroy(); }
+}
+
+//**************************************
+//Returns whether the coroutine finished
+//**************************************
+bool SessionTask::isDone() const
+{
+	return !handle || handle.done();
+}
+
+//*****************************************************
+//Runs the coroutine until it next suspends or finishes
+//*****************************************************
+void SessionTask::resume()
+{
+	if (!isDone()) { handle.resume(); }
+}
+
+//***************************************************************************************
+//Creates a session that runs its customer's commands on the shared machine and starts it
+//***************************************************************************************
+Session::Session(int client, VendingMachine& shared, ObjectPool<VendingMachine::Deposit>& depositPool)
+	: socket(client), output(&sent), machine(shared), deposits(depositPool), task(runSession(*this))
+{
+}
+
+//****************************************************************************************
+//Readies a closed session for another customer, keeping the memory its buffers have grown
+//****************************************************************************************
+void Session::reopen(int client)
+{
+	//the last customer's coroutine is destroyed first, so its memory can hold the new one
+	task = SessionTask();
+
+	socket = client;
+	place = 0;
+	events = 0;
+	received.clear();
+	nextLine = 0;
+	sent.pending.clear();
+	sent.written = 0;
+	output.clear();
+	customer = VendingMachine::Customer();
+	inputEnded = false;
+	waiting = false;
+	task = runSession(*this);
+}
+
+//***************************************************************************
+//Adds what the customer sent, first dropping the lines that have already run
+//***************************************************************************
+void Session::receive(const char* data, std::size_t length)
+{
+	received.erase(0, nextLine);
+	nextLine = 0;
+	received.append(data, length);
+}
+
+//*************************************************************************************************
+//Returns whether the session has a line it can run now, or has learnt that no more lines will come
+//*************************************************************************************************
+bool Session::canResume() const
+{
+	if (inputEnded) { return true; }
+
+	return sent.unwritten() < MAXUNWRITTEN && received.find('\n', nextLine) != std::string::npos;
+}
+
+//************************************************************************************************
+//Takes the next whole line the customer sent, returning false if there is none and none will come
+//************************************************************************************************
+bool Session::takeLine(std::string_view& line)
+{
+	std::size_t end = received.find('\n', nextLine);
+	if (end == std::string::npos) { return false; }
+
+	line = std::string_view(received.data() + nextLine, end - nextLine);
+	nextLine = end + 1;
+
+	return true;
+}
+
+//**********************************************************************************************************
+//Runs a line on the shared machine with the customer's deposit, giving it back to the pool once it is empty
+//**********************************************************************************************************
+bool Session::runLine(std::string_view line)
+{
+	//takes a deposit for the purchase the line may start, which a reused one from the pool is left empty for
+	if (customer.deposit == nullptr) {
+		customer.deposit = deposits.reuse();
+		if (customer.deposit == nullptr) { customer.deposit = deposits.make(); }
+	}
+
+	bool succeeded = machine.serve(customer, line, output);
+
+	//a purchase that COLA completed or RETURN refunded, or that never had money put in, ends with its deposit given back
+	if (customer.deposit->bufferValue == 0) {
+		deposits.release(customer.deposit);
+		customer.deposit = nullptr;
+	}
+
+	return succeeded;
+}
+
+//***************************************************************
+//Returns whether the customer has money deposited for a purchase
+//***************************************************************
+bool Session::hasDeposit() const
+{
+	return customer.deposit != nullptr;
+}
+
+//*********************************************************
+//Queues a suspended session to be resumed by the scheduler
+//*********************************************************
+void SessionScheduler::schedule(Session& session)
+{
+	//a session waits in the queue at most once, since it stops waiting for a line as soon as it is queued
+	session.waiting = false;
+	ready.push_back(&session);
+}
+
+//************************************************************************
+//Returns the next session to resume, or nullptr if none of them are ready
+//************************************************************************
+Session* SessionScheduler::next()
+{
+	if (ready.empty()) { return nullptr; }
+
+	Session* session = ready.front();
+	ready.pop_front();
+	return session;
+}
+
+//*************************************************************************************************
+//Runs one customer's commands as they arrive, suspending between lines, until they exit or hang up
+//*************************************************************************************************
+SessionTask runSession(Session& session)
+{
+	std::string_view line;
+
+	while (!session.customer.exited && co_await LineAwaiter(session, line)) {
+
+		//skips blank lines
+		if (line.find_first_not_of(" \t\r") == std::string_view::npos) { continue; }
+
+		//runs the command and ends its response with whether it succeeded
+		bool succeeded = session.runLine(line);
+		session.output << (succeeded ? "OK\n" : "ERROR\n");
+	}
+}
+
+#endif
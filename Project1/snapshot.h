@@ -0,0 +1,256 @@
+// snapshot.h - Antonio Mastroianni
+// Saves the vending machine's state to a fixed layout binary file and maps it back in on startup
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "vending.h"
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//the fixed layout start of a snapshot file, which is followed by the stock of each product and then a checksum of everything before it
+struct SnapshotHeader
+{
+	char magic[8] = { 'V','E','N','D','S','N','A','P' };
+	std::uint32_t version = 2; //changes whenever the layout does
+	std::uint32_t size = 0; //the size of the whole file
+	std::uint64_t passwordHash = 0;
+	std::uint64_t catalogFingerprint = 0;
+	decltype(VendingMachine::State::coins) coins = {};
+	decltype(VendingMachine::State::bills) bills = {};
+	std::int32_t cups = 0;
+	decltype(VendingMachine::State::coinsBuffer) coinsBuffer = {};
+	decltype(VendingMachine::State::billsBuffer) billsBuffer = {};
+	std::int32_t serviceMode = 0;
+	std::int32_t amountOfCola = 0;
+	std::int32_t reserved = 0; //keeps the layout free of padding
+};
+
+static_assert(std::is_trivially_copyable<SnapshotHeader>::value, "a snapshot must be saved and loaded as raw bytes");
+static_assert(sizeof(SnapshotHeader) % 8 == 0, "the snapshot header must not leave padding");
+
+//****************************************
+//Works out the checksum of a run of bytes
+//****************************************
+std::uint64_t snapshotChecksum(const unsigned char* bytes, std::size_t length)
+{
+	std::uint64_t hash = 14695981039346656037ull;
+
+	for (std::size_t i = 0; i < length; i++)
+		{ hash = (hash ^ bytes[i]) * 1099511628211ull; }
+
+	return hash;
+}
+
+//**********************************************************************************
+//Checks that mapped bytes hold a whole, undamaged snapshot and copies out its state
+//**********************************************************************************
+bool readSnapshotBytes(const void* bytes, std::size_t length, VendingMachine::State& state)
+{
+	const unsigned char* data = static_cast<const unsigned char*>(bytes);
+	SnapshotHeader header;
+	SnapshotHeader expected;
+	std::uint64_t checksum;
+
+	if (length < sizeof(SnapshotHeader) + sizeof(checksum)) { return false; }
+	std::memcpy(&header, data, sizeof(SnapshotHeader));
+	std::memcpy(&checksum, data + length - sizeof(checksum), sizeof(checksum));
+
+	std::size_t colaBytes = length - sizeof(SnapshotHeader) - sizeof(checksum);
+	if (std::memcmp(header.magic, expected.magic, sizeof(expected.magic)) != 0 || header.version != expected.version
+		|| header.size != length || header.amountOfCola < 0 || colaBytes != static_cast<std::size_t>(header.amountOfCola) * sizeof(std::int32_t)
+		|| checksum != snapshotChecksum(data, length - sizeof(checksum)))
+		{ return false; }
+
+	state.passwordHash = header.passwordHash;
+	state.catalogFingerprint = header.catalogFingerprint;
+	std::memcpy(state.coins, header.coins, sizeof(state.coins));
+	std::memcpy(state.bills, header.bills, sizeof(state.bills));
+	state.cups = header.cups;
+	std::memcpy(state.coinsBuffer, header.coinsBuffer, sizeof(state.coinsBuffer));
+	std::memcpy(state.billsBuffer, header.billsBuffer, sizeof(state.billsBuffer));
+	state.serviceMode = header.serviceMode;
+	state.cola.resize(header.amountOfCola);
+	if (colaBytes > 0) { std::memcpy(state.cola.data(), data + sizeof(SnapshotHeader), colaBytes); }
+
+	return true;
+}
+
+//*****************************************************************************************
+//Maps a snapshot file into memory and loads its state, returning false if there is no file
+//*****************************************************************************************
+bool loadSnapshot(const std::string& fileName, VendingMachine::State& state)
+{
+	bool loaded = false;
+	bool found = false;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file != INVALID_HANDLE_VALUE) {
+		found = true;
+		LARGE_INTEGER length;
+		HANDLE mapping = nullptr;
+		if (GetFileSizeEx(file, &length) && length.QuadPart > 0)
+			{ mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr); }
+		if (mapping != nullptr) {
+			if (const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) {
+				loaded = readSnapshotBytes(view, static_cast<std::size_t>(length.QuadPart), state);
+				UnmapViewOfFile(view);
+			}
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+	}
+#else
+	int file = open(fileName.c_str(), O_RDONLY);
+	if (file >= 0) {
+		found = true;
+		struct stat status;
+		if (fstat(file, &status) == 0 && status.st_size > 0) {
+			void* view = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+			if (view != MAP_FAILED) {
+				loaded = readSnapshotBytes(view, static_cast<std::size_t>(status.st_size), state);
+				munmap(view, static_cast<std::size_t>(status.st_size));
+			}
+		}
+		close(file);
+	}
+#endif
+
+	//a damaged snapshot is reported and ignored so the machine still starts
+	if (found && !loaded)
+		{ std::cerr << fileName << " is not a valid snapshot, starting with an empty machine\n"; }
+
+	return loaded;
+}
+
+//*******************************************************************************************
+//Saves a state by writing a new snapshot beside the old one and then replacing it atomically
+//*******************************************************************************************
+bool saveSnapshot(const std::string& fileName, const VendingMachine::State& state)
+{
+	SnapshotHeader header;
+	std::uint64_t checksum;
+	std::size_t colaBytes = state.cola.size() * sizeof(std::int32_t);
+
+	header.size = static_cast<std::uint32_t>(sizeof(SnapshotHeader) + colaBytes + sizeof(checksum));
+	header.passwordHash = state.passwordHash;
+	header.catalogFingerprint = state.catalogFingerprint;
+	std::memcpy(header.coins, state.coins, sizeof(state.coins));
+	std::memcpy(header.bills, state.bills, sizeof(state.bills));
+	header.cups = state.cups;
+	std::memcpy(header.coinsBuffer, state.coinsBuffer, sizeof(state.coinsBuffer));
+	std::memcpy(header.billsBuffer, state.billsBuffer, sizeof(state.billsBuffer));
+	header.serviceMode = state.serviceMode;
+	header.amountOfCola = static_cast<std::int32_t>(state.cola.size());
+
+	//lays the whole snapshot out in memory so it is written in one call
+	std::vector<unsigned char> snapshot(header.size);
+	std::memcpy(snapshot.data(), &header, sizeof(SnapshotHeader));
+	if (colaBytes > 0) { std::memcpy(snapshot.data() + sizeof(SnapshotHeader), state.cola.data(), colaBytes); }
+	checksum = snapshotChecksum(snapshot.data(), snapshot.size() - sizeof(checksum));
+	std::memcpy(snapshot.data() + snapshot.size() - sizeof(checksum), &checksum, sizeof(checksum));
+
+	//the old snapshot is only replaced once the new one is fully on disk, so a crash leaves one or the other
+	std::string temporaryName = fileName + ".tmp";
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(temporaryName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) { return false; }
+
+	DWORD written = 0;
+	bool saved = WriteFile(file, snapshot.data(), static_cast<DWORD>(snapshot.size()), &written, nullptr) && written == snapshot.size() && FlushFileBuffers(file);
+	CloseHandle(file);
+
+	return saved && MoveFileExA(temporaryName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+	int file = open(temporaryName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (file < 0) { return false; }
+
+	bool saved = write(file, snapshot.data(), snapshot.size()) == static_cast<ssize_t>(snapshot.size()) && fsync(file) == 0;
+	close(file);
+	if (!saved || rename(temporaryName.c_str(), fileName.c_str()) != 0) { return false; }
+
+	//syncs the directory so the rename itself survives a crash
+	std::string::size_type slash = fileName.find_last_of('/');
+	std::string directoryName = (slash == std::string::npos) ? "." : (slash == 0 ? "/" : fileName.substr(0, slash));
+	int directory = open(directoryName.c_str(), O_RDONLY);
+	if (directory >= 0) {
+		fsync(directory);
+		close(directory);
+	}
+
+	return true;
+#endif
+}
+
+//saves a machine's state after each command, but only when the state actually changed
+class SnapshotKeeper
+{
+private:
+
+	std::string fileName;
+	VendingMachine::State saved;
+	VendingMachine::State current; //kept between commands so checking for changes does not allocate
+
+public:
+
+	explicit SnapshotKeeper(std::string);
+	void restore(VendingMachine&);
+	void update(VendingMachine&);
+};
+
+
+//********************************************
+//Creates a keeper for the given snapshot file
+//********************************************
+SnapshotKeeper::SnapshotKeeper(std::string name)
+	: fileName(std::move(name))
+{
+}
+
+//*************************************************************
+//Brings a machine back to its last saved state if there is one
+//*************************************************************
+void SnapshotKeeper::restore(VendingMachine& machine)
+{
+	if (loadSnapshot(fileName, saved)) {
+		if (machine.setState(saved)) { return; }
+		std::cerr << fileName << " was saved by a machine selling other products, starting with an empty machine\n";
+	}
+
+	machine.getState(saved);
+}
+
+//***************************************************************
+//Saves the machine's state if it changed since it was last saved
+//***************************************************************
+void SnapshotKeeper::update(VendingMachine& machine)
+{
+	machine.getState(current);
+
+	if (current == saved) { return; }
+
+	if (saveSnapshot(fileName, current))
+		{ std::swap(saved, current); }
+	else
+		{ std::cerr << "Unable to save the machine's state to " << fileName << '\n'; }
+}
+
+#endif
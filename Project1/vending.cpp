@@ -2,25 +2,271 @@
 // This program emulates the functionality of a vending machine in order to give insight into how an operating system's command line interpreter works
 
 //NOTE: The default password is password
+//      The interactive machine keeps its state in vending.state between runs, scripts only do so when given --state <file>
+//      The interactive machine records every sale, refund, restock and lock in vending.log, scripts only do so when given --log <file>
+//      --serve <socket> serves the machine to many clients over a Unix domain socket instead of the console
+//      --compile compiles a script before running it, and --repeat <n> runs the compiled script n times without parsing it again
 
+#define NOMINMAX
 #include "vending.h"
+#include "bytecode.h"
+#include "console.h"
+#include "pipeline.h"
+#include "snapshot.h"
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#ifndef _WIN32
+#include "server.h"
+#endif
+
+//**************************************************************
+//Displays every record of an event log and returns an exit code
+//**************************************************************
+int printLog(const std::string& logName, const Catalog& catalog)
+{
+	const char* eventNames[] = { "", "SALE", "REFUND", "RESTOCK", "MONEY", "LOCK", "UNLOCK" };
+	using Currency = VendingMachine::CurrencyType;
+	const int AMOUNTOFCOINS = static_cast<int>(std::size(Currency::COINS));
+	const int AMOUNTOFDENOMINATIONS = AMOUNTOFCOINS + static_cast<int>(std::size(Currency::BILLS));
+
+	EventLogReader reader(logName);
+	if (!reader.isOpen()) {
+		std::cerr << "Unable to open " << logName << '\n';
+		return 2;
+	}
+
+	std::cout << "sequence,time_us,event,item,quantity,cents\n";
+	EventRecord record;
+	std::uint64_t lastGood = 0; //the sequence of the last record that passed its checksum, or 0 if none has
+	while (reader.next(record)) {
+		lastGood = record.sequence;
+		std::string_view item;
+		if (record.type == EVENTRESTOCK && record.item == EVENTITEMCUPS) { item = "CUPS"; }
+		else if (record.type == EVENTSALE || record.type == EVENTRESTOCK) { item = record.item < catalog.size() ? catalog.name(record.item) : "?"; }
+		else if (record.type == EVENTMONEY && record.item < AMOUNTOFCOINS) { item = Currency::COINS[record.item].name; }
+		else if (record.type == EVENTMONEY && record.item < AMOUNTOFDENOMINATIONS) { item = Currency::BILLS[record.item - AMOUNTOFCOINS].name; }
+
+		std::cout << record.sequence << ',' << record.time << ',' << eventNames[record.type % 7] << ',' << item << ','
+			<< record.quantity << ',' << record.cents << '\n';
+	}
+
+	//returns 1 if the log holds a damaged record
+	if (reader.isDamaged()) {
+		//the damaged record's own sequence may be what was damaged, so it is placed after the last record that was read
+		if (lastGood == 0) { std::cerr << logName << " has a damaged record at the start\n"; }
+		else { std::cerr << logName << " has a damaged record after sequence " << lastGood << '\n'; }
+		return 1;
+	}
+	return 0;
+}
+
+//**************************************************************************************
+//Runs a script of commands without prompts or colors and returns a summarized exit code
+//**************************************************************************************
+int runBatch(std::istream& script, bool stopOnError, bool compile, int repeat, const std::string& stateName, EventLog* eventLog, const Catalog& catalog)
+{
+	std::string_view userInput;
+	int commandsRun = 0;
+	int commandsFailed = 0;
+
+	//prompts are never shown so the streams do not need to stay in step with each other
+	std::ios::sync_with_stdio(false);
+	std::cin.tie(nullptr);
+
+	//the script is read and the output written on threads of their own, so the machine only waits on them when they fall behind
+	LineReader reader(script);
+	OutputWriter writer(*std::cout.rdbuf());
+	std::ostream output(&writer);
+
+	VendingMachine mainMachine(output);
+	mainMachine.setCatalog(catalog);
+	mainMachine.setEventLog(eventLog);
+	CommandMetrics metrics;
+	mainMachine.setMetrics(&metrics);
+	SalesAnalytics analytics(catalog.size(), denominationCount<VendingMachine::CurrencyType>());
+	mainMachine.setAnalytics(&analytics);
+	StockAlerts alerts(catalog.size(), coinCount<VendingMachine::CurrencyType>(), denominationCount<VendingMachine::CurrencyType>());
+	mainMachine.setAlerts(&alerts);
+	SnapshotKeeper snapshot(stateName);
+	if (stateName != "") { snapshot.restore(mainMachine); }
+
+	//runs the whole script once it has been compiled, as many times as asked, until the machine is told to exit
+	if (compile) {
+		CompiledScript<VendingMachine> program;
+		while (reader.nextLine(userInput))
+			{ program.add(userInput, mainMachine); }
+
+		bool stopped = false;
+		for (int pass = 0; pass < repeat && !stopped; pass++) {
+			for (int i = 0; i < program.size() && !stopped; i++) {
+				if (!mainMachine.getProgramRunningStatus()) {
+					stopped = true;
+					break;
+				}
+
+				commandsRun++;
+				bool succeeded = program.run(i, mainMachine);
+				if (stateName != "") { snapshot.update(mainMachine); }
+
+				if (!succeeded) {
+					commandsFailed++;
+					if (stopOnError) { stopped = true; }
+				}
+			}
+		}
+	}
+
+	//runs each line of the script until it ends or the machine is told to exit
+	while (!compile && mainMachine.getProgramRunningStatus()) {
+
+		//lets the output so far be seen before waiting on a script that is still being written, such as a pipe
+		if (reader.mayWaitForInput()) { output.flush(); }
+		if (!reader.nextLine(userInput)) { break; }
+
+		//skips blank lines
+		if (userInput.find_first_not_of(" \t\r") == std::string_view::npos)
+			{ continue; }
+
+		commandsRun++;
+		bool succeeded = mainMachine.parseCommand(userInput);
+		if (stateName != "") { snapshot.update(mainMachine); }
+
+		if (!succeeded) {
+			commandsFailed++;
+			if (stopOnError) { break; }
+		}
+	}
+
+	writer.finish();
+	std::cout.flush();
+	if (eventLog != nullptr && !eventLog->flush()) { std::cerr << "Unable to write every event to the log\n"; }
+	std::cerr << commandsFailed << " of " << commandsRun << " commands failed\n";
+
+	//returns 0 if every command succeeded and 1 if any failed (2 is used for unusable arguments or scripts)
+	return commandsFailed == 0 ? 0 : 1;
+}
 
 //*************
 //Main Function
 //*************
-int main() {
+int main(int argc, char* argv[]) {
+
+	std::string scriptName;
+	std::string stateName;
+	std::string logName;
+	std::string printLogName;
+	std::string catalogName;
+	std::string socketName;
+	int logLatency = 10; //the longest, in milliseconds, an event waits before it is synced to disk
+	int repeat = 1; //how many times a compiled script is run
+	bool stopOnError = false;
+	bool compile = false;
+	bool validArguments = true;
+
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "--batch" && i + 1 < argc) { scriptName = argv[++i]; }
+		else if (argument == "--state" && i + 1 < argc) { stateName = argv[++i]; }
+		else if (argument == "--log" && i + 1 < argc) { logName = argv[++i]; }
+		else if (argument == "--log-latency" && i + 1 < argc) { logLatency = std::atoi(argv[++i]); }
+		else if (argument == "--print-log" && i + 1 < argc) { printLogName = argv[++i]; }
+		else if (argument == "--catalog" && i + 1 < argc) { catalogName = argv[++i]; }
+		else if (argument == "--serve" && i + 1 < argc) { socketName = argv[++i]; }
+		else if (argument == "--stop-on-error") { stopOnError = true; }
+		else if (argument == "--compile") { compile = true; }
+		else if (argument == "--repeat" && i + 1 < argc) {
+			repeat = std::atoi(argv[++i]);
+			compile = true;
+		}
+		else { validArguments = false; }
+	}
+
+	//displays the usage and returns 2 if the arguments are not understood
+	if (!validArguments || ((stopOnError || compile) && scriptName == "") || logLatency < 0 || repeat < 1 || (socketName != "" && (scriptName != "" || stateName != ""))) {
+		std::cerr << "Usage: " << argv[0] << " [--catalog <file>] [--state <file>] [--log <file>] [--log-latency <ms>] [--batch <file|-> [--stop-on-error] [--compile] [--repeat <n>]]\n"
+			<< "       " << argv[0] << " [--catalog <file>] [--log <file>] [--log-latency <ms>] --serve <socket>\n"
+			<< "       " << argv[0] << " [--catalog <file>] --print-log <file>\n";
+		return 2;
+	}
+
+	//sells the products listed in the catalog file if one is given, or the standard five colas
+	Catalog loadedCatalog;
+	if (catalogName != "" && !loadCatalog(catalogName, loadedCatalog))
+		{ return 2; }
+	const Catalog& catalog = (catalogName != "") ? loadedCatalog : Catalog::standard();
+
+	//displays an event log instead of running the machine if --print-log <file> is given
+	if (printLogName != "")
+		{ return printLog(printLogName, catalog); }
+
+	//opens the event log, which the interactive machine always keeps
+	if (logName == "" && scriptName == "" && socketName == "") { logName = "vending.log"; }
+	std::unique_ptr<EventLog> eventLog;
+	if (logName != "") {
+		eventLog = std::make_unique<EventLog>(logName, std::chrono::milliseconds(logLatency));
+		if (!eventLog->isOpen()) {
+			std::cerr << "Unable to open " << logName << '\n';
+			return 2;
+		}
+	}
+
+	//serves the machine to clients over a Unix domain socket instead of the interactive prompt if --serve <socket> is given
+	if (socketName != "") {
+#ifdef _WIN32
+		std::cerr << "--serve needs Unix domain sockets and epoll, which this platform does not have\n";
+		return 2;
+#else
+		CommandServer server(socketName, catalog, eventLog.get());
+		return server.run();
+#endif
+	}
+
+	//runs a script instead of the interactive prompt if --batch <file|-> is given
+	if (scriptName != "") {
+
+		//reads the script from standard input if the name is -
+		if (scriptName == "-")
+			{ return runBatch(std::cin, stopOnError, compile, repeat, stateName, eventLog.get(), catalog); }
+
+		std::ifstream script(scriptName);
+		if (!script) {
+			std::cerr << "Unable to open " << scriptName << '\n';
+			return 2;
+		}
+		return runBatch(script, stopOnError, compile, repeat, stateName, eventLog.get(), catalog);
+	}
+
 	//creates a string to hold the user's input
 	std::string userInput; 
 
+	//colors are only written when the output is a terminal, a piped replay gets plain text
+	ConsoleColor color;
+
+	//when no one is typing or watching, the output no longer has to be flushed before every line is read
+	if (!isTerminal(stdin) && !isTerminal(stdout)) {
+		std::ios::sync_with_stdio(false);
+		std::cin.tie(nullptr);
+	}
+
 	//outputs the next string in a red color text
-	const HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
-	SetConsoleTextAttribute(h, 4); 
+	color.set(CONSOLERED);
 	std::cout << "Please Enter a command and its parameter(s)\n\n\t(type HELP for list of commands, EXIT to quit)\n";
 	//sets the next string to output in a white color text
-	SetConsoleTextAttribute(h, 15);
+	color.set(CONSOLEWHITE);
 
-	//creates the "vending machine" object
+	//creates the "vending machine" object and brings back the state it was left in
 	VendingMachine mainMachine;
+	mainMachine.setCatalog(catalog);
+	mainMachine.setEventLog(eventLog.get());
+	CommandMetrics metrics;
+	mainMachine.setMetrics(&metrics);
+	SalesAnalytics analytics(catalog.size(), denominationCount<VendingMachine::CurrencyType>());
+	mainMachine.setAnalytics(&analytics);
+	StockAlerts alerts(catalog.size(), coinCount<VendingMachine::CurrencyType>(), denominationCount<VendingMachine::CurrencyType>());
+	mainMachine.setAlerts(&alerts);
+	SnapshotKeeper snapshot(stateName != "" ? stateName : "vending.state");
+	snapshot.restore(mainMachine);
 
 	//continually gets the user's input and operates according to it until the vending machine has an exit status
 	while (mainMachine.getProgramRunningStatus()) {
@@ -31,15 +277,16 @@ int main() {
 			{ std::cout << "\n[NORMAL MODE] >"; }
 
 		//switches font color to red to denote the user's input
-		SetConsoleTextAttribute(h, 4); 
+		color.set(CONSOLERED);
 		std::getline(std::cin, userInput);
 
 		//switches font color to white to denote the console's output
-		SetConsoleTextAttribute(h, 15);
+		color.set(CONSOLEWHITE);
 		std::cout << '\n';
 
 		//the "vending machine" object handles all operations with the user's input
 		mainMachine.parseCommand(userInput);
+		snapshot.update(mainMachine);
 	}
 
 	return 0;
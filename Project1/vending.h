@@ -4,113 +4,640 @@
 #ifndef SODA_H
 #define SODA_H
 
-#define NOMINMAX
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <charconv>
+#include <climits>
+#include <cstdint>
 #include <iostream>
 #include <string>
-#include <windows.h>
 #include <iomanip>
-#include <sstream>
+#include <string_view>
+#include <memory>
+#include <vector>
+#include "alerts.h"
+#include "allocations.h"
+#include "analytics.h"
+#include "catalog.h"
+#include "change.h"
+#include "currency.h"
+#include "eventlog.h"
+#include "manifest.h"
+#include "metrics.h"
+#include "report.h"
+
+//holds the whitespace separated tokens of a single input line without copying them
+struct CommandTokens
+{
+	const static int MAXTOKENS = 5; //a command, an option, two switches and one extra token to detect too many parameters
+	std::string_view token[MAXTOKENS];
+	int count = 0;
+
+	void split(const std::string&);
+	void toUpper(std::string&, int);
+	std::string_view operator[](int) const;
+};
+
+template <typename Machine>
+struct CommandRecord;
+
+//hashes a password so that only the hash is ever held or saved
+constexpr std::uint64_t hashPassword(std::string_view s)
+{
+	std::uint64_t hash = 14695981039346656037ull;
+	for (char c : s)
+		{ hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull; }
+
+	return hash;
+}
+
+//counts how each purchase attempt turned out
+struct PurchaseStatistics
+{
+	long long sales = 0;
+	long long soldOut = 0;
+	long long noChange = 0;
+	long long noCups = 0;
+};
 
 //creates a VendingMachine class to allow easy communication between functions relating to the object.
-class VendingMachine
+//the machine is built for one currency, so every loop over its coins and bills has a count known at compile time
+template <typename Currency>
+class BasicVendingMachine
 {
 private:
 
 	//private variables
-	std::string password = "password";
-	const int PRICE = 145;
-	const static int AMOUNTOFCOINS = 3;
-	const static int AMOUNTOFBILLS = 2;
-	const static int SIZEOFCOLATYPES = 5;
-	int coins[AMOUNTOFCOINS] = { 0,0,0 };
-	int bills[AMOUNTOFBILLS] = { 0,0 };
-	int cola[SIZEOFCOLATYPES] = { 0,0,0,0,0 };
-	std::string colaTypes[SIZEOFCOLATYPES] = { "COKE", "PEPSI", "SPRITE", "FANTA", "FAYGO" };
-	int cups = 0;
+	std::uint64_t passwordHash = hashPassword("password");
+	const static int PRICE = 145;
+	const static int AMOUNTOFCOINS = static_cast<int>(std::size(Currency::COINS));
+	const static int AMOUNTOFBILLS = static_cast<int>(std::size(Currency::BILLS));
+	constexpr static std::array<int, AMOUNTOFCOINS> COINVALUES = denominationValues(Currency::COINS); //the value in cents of each coin
+	constexpr static std::array<int, AMOUNTOFBILLS> BILLVALUES = denominationValues(Currency::BILLS); //the value in cents of each bill
+	const static int AMOUNTOFDENOMINATIONS = AMOUNTOFCOINS + AMOUNTOFBILLS;
+	static_assert(AMOUNTOFDENOMINATIONS <= MAXDENOMINATIONS, "a change plan must have room for every coin and bill");
+	const static int MAXCHANGEATTEMPTS = 8; //how many times a purchase re-plans its change after losing it to another session
+
+public:
+
+	//the stock and money a machine holds, which several machines (such as kiosks) may share
+	//every count is changed with lock-free atomic operations so sessions never oversell or hand out the same coin
+	struct Inventory
+	{
+		std::atomic<int> coins[AMOUNTOFCOINS] = {};
+		std::atomic<int> bills[AMOUNTOFBILLS] = {};
+		std::unique_ptr<std::atomic<int>[]> cola; //the stock of each product in the catalog, by its slot
+		int amountOfCola = 0;
+		std::atomic<int> cups{ 0 };
+		std::atomic<unsigned int> changeVersion{ 0 }; //changes whenever coins or bills are added or taken
+
+		explicit Inventory(int = Catalog::standard().size());
+		Inventory(const Inventory&);
+		Inventory& operator=(const Inventory&);
+		long long heldValue() const;
+		void setProducts(int);
+		static bool take(std::atomic<int>&, int);
+		static int takeUpTo(std::atomic<int>&, int);
+	};
+
+	//everything needed to bring a machine back exactly as it was
+	struct State
+	{
+		std::uint64_t passwordHash = 0;
+		std::uint64_t catalogFingerprint = 0; //the catalog the cola counts belong to
+		std::int32_t coins[AMOUNTOFCOINS] = {};
+		std::int32_t bills[AMOUNTOFBILLS] = {};
+		std::int32_t cups = 0;
+		std::int32_t coinsBuffer[AMOUNTOFCOINS] = {};
+		std::int32_t billsBuffer[AMOUNTOFBILLS] = {};
+		std::int32_t serviceMode = 0;
+		std::vector<std::int32_t> cola; //the stock of each product in the catalog, by its slot
+
+		bool operator==(const State&) const;
+	};
+
+	//the money one customer has deposited toward a purchase, kept apart from the machine so one machine can serve many customers
+	struct Deposit
+	{
+		int coinsBuffer[AMOUNTOFCOINS] = {}; //holds the amount of coins deposited into the buffer
+		int billsBuffer[AMOUNTOFBILLS] = {}; //holds the amount of bills deposited into the buffer
+		int bufferValue = 0; //holds the value in cents of everything deposited into the buffer
+	};
+
+	//one of the customers a machine serves in turn, such as a server's client, with the deposit and mode that are theirs alone
+	struct Customer
+	{
+		Deposit* deposit = nullptr; //the deposit the customer's commands spend from and add to
+		bool serviceMode = false;
+		bool exited = false; //set once the customer has run EXIT
+	};
+
+private:
+
+	const Catalog* catalog = &Catalog::standard(); //the products the machine sells
+	Inventory ownInventory; //the inventory used unless the machine was given a shared one
+	Inventory* sharedInventory = nullptr;
+	unsigned int changeTableVersion = 0; //the changeVersion of the inventory the change table was built from
 	bool runProgram = true;
+	bool commandFailed = false; //set when the command being run reports an error
 	bool serviceMode = true;
-	int coinsBuffer[AMOUNTOFCOINS] = { 0,0,0 }; //holds the amount of coins deposited into the buffer
-	int billsBuffer[AMOUNTOFBILLS] = { 0,0 }; //holds the amount of bills deposited into the buffer
+	Deposit ownDeposit; //the deposit used unless the machine is serving a customer with their own
+	Deposit* customerDeposit = nullptr;
+	ChangeTable changeTable; //caches which amounts of change can be made from the coins and bills held
+	std::ostream* output; //where everything the machine displays is written
+	PurchaseStatistics statistics;
+	EventLog* eventLog = nullptr; //where every change to the stock and money is recorded, if anywhere
+	ReportBuffer statusReport; //the status table, laid out in full before it is displayed
+	std::string commandLine; //the line being run, upper cased in place as it is parsed
+	unsigned long long commandAllocations = 0; //the heap allocations made while running commands since the last ALLOCS command
+	long long commandsCounted = 0;
+#if VENDING_METRICS
+	CommandMetrics* metrics = nullptr; //where the time each command takes is recorded, if anywhere
+#endif
+	SalesAnalytics* analytics = nullptr; //where every sale and deposit is counted, if anywhere
+	StockAlerts* alerts = nullptr; //where items running low are watched for, if anywhere
+	std::vector<int> restockQuantities; //how many of each product, the cups, each coin and each bill a manifest restocks
 
 public:
 
+	using CurrencyType = Currency;
+
+	explicit BasicVendingMachine(std::ostream& = std::cout);
+	BasicVendingMachine(Inventory&, std::ostream& = std::cout);
+	bool serve(Customer&, std::string_view, std::ostream&);
+
 	//function prototypes
-	void coinCmd(std::string);
-	void billCmd(std::string);
-	void colaCmd(std::string, std::string);
+	void coinCmd(std::string_view);
+	void billCmd(std::string_view);
+	void colaCmd(std::string_view, std::string_view);
+	void depositCoin(int, std::string_view);
+	void depositBill(int, std::string_view);
+	void buyCola(int, std::string_view, std::string_view);
+	void addCola(int, int, std::string_view);
+	void addCups(int);
+	void addDenomination(int, int, std::string_view);
+	void removeDenomination(int, int, std::string_view);
 	void returnCmd();
 	void statusCmd();
-	void unlockCmd(std::string);
-	void lockCmd(std::string);
+	void unlockCmd(std::string_view);
+	void lockCmd(std::string_view);
 	void helpCmd();
-	void dispenseChange();
-	void dispenseCola(int, std::string, std::string);
-	void adjustItemCountCmd(std::string, std::string, std::string, std::string);
+	void allocsCmd();
+	void metricsCmd(bool);
+	void salesCmd(int);
+	void alertsCmd();
+	void thresholdCmd(std::string_view, std::string_view, std::string_view);
+	void restockCmd(std::string_view);
+	void dispenseChange(const ChangePlan&);
+	void dispenseCola(int, std::string_view, std::string_view, const ChangePlan&);
+	void adjustItemCountCmd(std::string_view, std::string_view, std::string_view, std::string_view);
 	int convertBufferToValue();
-	int convertStringCoinToInt(std::string);
-	int convertStringBillToInt(std::string);
-	int convertStringColaToInt(std::string);
-	bool checkIfChangeAvailable(double);
-	bool checkForValidCola(std::string);
-	bool checkForValidChange(std::string s);
-	bool checkForValidBill(std::string s);
-	bool checkForAvailableCola(std::string);
-	int convertStringToNumber(std::string);
-	void addRemoveDenomination(std::string, std::string, std::string, std::string);
-	void parseCommand(std::string);
-	void parseOption(std::string, std::string);
-	void parseSwitch(std::string, std::string, std::string);
-	void goToCmd(std::string, std::string, std::string, std::string);
+	int convertStringCoinToInt(std::string_view);
+	int convertStringBillToInt(std::string_view);
+	int convertStringColaToInt(std::string_view);
+	int convertStringToWindow(std::string_view);
+	bool checkIfChangeAvailable(ChangePlan&);
+	bool takeChange(const ChangePlan&);
+	void giveBackChange(const ChangePlan&);
+	bool reserveChange(ChangePlan&);
+	void getChangeInventory(int[], int[]);
+	bool checkForValidCola(std::string_view);
+	bool checkForValidChange(std::string_view);
+	bool checkForValidBill(std::string_view);
+	bool checkForAvailableCola(int);
+	int convertStringToNumber(std::string_view);
+	void addRemoveDenomination(std::string_view, std::string_view, std::string_view, std::string_view);
+	bool parseCommand(std::string_view);
+	template <typename Operation>
+	bool runCommand(int, Operation&&);
+	template <typename Operation>
+	void timeCommand(int, Operation&&);
+	void parseOption(const CommandRecord<BasicVendingMachine>&, CommandTokens&, std::string&);
+	void parseSwitch(const CommandRecord<BasicVendingMachine>&, CommandTokens&, std::string&);
+	void goToCmd(const CommandRecord<BasicVendingMachine>&, const CommandTokens&);
+	void goToExitCmd(const CommandTokens&);
+	void goToHelpCmd(const CommandTokens&);
+	void goToReturnCmd(const CommandTokens&);
+	void goToLockCmd(const CommandTokens&);
+	void goToUnlockCmd(const CommandTokens&);
+	void goToStatusCmd(const CommandTokens&);
+	void goToCoinCmd(const CommandTokens&);
+	void goToBillCmd(const CommandTokens&);
+	void goToColaCmd(const CommandTokens&);
+	void goToAddRemoveCmd(const CommandTokens&);
+	void goToAllocsCmd(const CommandTokens&);
+	void goToMetricsCmd(const CommandTokens&);
+	void goToSalesCmd(const CommandTokens&);
+	void goToAlertsCmd(const CommandTokens&);
+	void goToRestockCmd(const CommandTokens&);
 	bool getProgramRunningStatus();
 	bool getModeStatus();
-	std::string toUpper(std::string);
+	const PurchaseStatistics& getStatistics();
+	void getState(State&);
+	bool setState(const State&);
+	void setEventLog(EventLog*);
+	void setMetrics(CommandMetrics*);
+	void setAnalytics(SalesAnalytics*);
+	void setAlerts(StockAlerts*);
+	void checkStock(int);
+	void checkAllStock();
+	void setCatalog(const Catalog&);
+	const Catalog& getCatalog();
+	void logEvent(int, int, int, int);
+	static int moneyValue(int, int);
+	Inventory& inventory();
+	Deposit& deposit();
+	std::ostream& errorStream();
+	std::string& toUpper(std::string&);
+};
+
+//the modes a command may be run in
+const int NORMALMODE = 1;
+const int SERVICEMODE = 2;
+
+//describes a command: how many parameters it takes, the modes it runs in and the function that runs it
+template <typename Machine>
+struct CommandRecord
+{
+	std::string_view name;
+	int minParameters;
+	int maxParameters;
+	int modes;
+	bool keepOptionCase; //the option is passed on exactly as typed, such as a password
+	void (Machine::*handler)(const CommandTokens&);
+};
+
+//list of possible commands
+template <typename Machine>
+constexpr CommandRecord<Machine> commandRecords[] = {
+	{ "UNLOCK",  1, 1, NORMALMODE,               true,  &Machine::goToUnlockCmd },
+	{ "HELP",    0, 0, NORMALMODE | SERVICEMODE, false, &Machine::goToHelpCmd },
+	{ "COIN",    1, 1, NORMALMODE | SERVICEMODE, false, &Machine::goToCoinCmd },
+	{ "BILL",    1, 1, NORMALMODE | SERVICEMODE, false, &Machine::goToBillCmd },
+	{ "COLA",    1, 2, NORMALMODE | SERVICEMODE, false, &Machine::goToColaCmd },
+	{ "RETURN",  0, 0, NORMALMODE | SERVICEMODE, false, &Machine::goToReturnCmd },
+	{ "STATUS",  0, 0, NORMALMODE | SERVICEMODE, false, &Machine::goToStatusCmd },
+	{ "EXIT",    0, 0, NORMALMODE | SERVICEMODE, false, &Machine::goToExitCmd },
+	{ "ADD",     1, 3, SERVICEMODE,              false, &Machine::goToAddRemoveCmd },
+	{ "REMOVE",  1, 3, SERVICEMODE,              false, &Machine::goToAddRemoveCmd },
+	{ "LOCK",    1, 1, SERVICEMODE,              true,  &Machine::goToLockCmd },
+	{ "ALLOCS",  0, 0, SERVICEMODE,              false, &Machine::goToAllocsCmd },
+	{ "METRICS", 0, 1, SERVICEMODE,              false, &Machine::goToMetricsCmd },
+	{ "SALES",   0, 1, SERVICEMODE,              false, &Machine::goToSalesCmd },
+	{ "ALERTS",  0, 3, SERVICEMODE,              false, &Machine::goToAlertsCmd },
+	{ "RESTOCK", 1, 1, SERVICEMODE,              true,  &Machine::goToRestockCmd },
+};
+
+//hashes a command name, the seed is picked at compile time so that no two commands share a slot
+constexpr unsigned int hashCommand(std::string_view s, unsigned int seed)
+{
+	unsigned int hash = seed;
+	for (char c : s)
+		{ hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u; }
+
+	return hash;
+}
+
+//a perfect hash table from a command name to its record, built entirely at compile time
+template <typename Machine>
+class CommandTable
+{
+private:
+
+	const static int TABLESIZE = 32;
+	const static int NUMOFCOMMANDS = sizeof(commandRecords<Machine>) / sizeof(commandRecords<Machine>[0]);
+	unsigned int seed = 0;
+	int slots[TABLESIZE] = {};
+
+	//tries to place every command into its own slot with the given seed
+	constexpr bool placeCommands(unsigned int trySeed)
+	{
+		for (int i = 0; i < TABLESIZE; i++)
+			{ slots[i] = -1; }
+
+		for (int i = 0; i < NUMOFCOMMANDS; i++) {
+			unsigned int slot = hashCommand(commandRecords<Machine>[i].name, trySeed) % TABLESIZE;
+			if (slots[slot] != -1) { return false; }
+			slots[slot] = i;
+		}
+
+		return true;
+	}
+
+public:
+
+	constexpr CommandTable()
+	{
+		static_assert(NUMOFCOMMANDS <= TABLESIZE, "the command table is too small for every command");
+		static_assert(NUMOFCOMMANDS <= MAXTIMEDCOMMANDS, "every command must have its own latency histogram");
+
+		//searches for the first seed that gives every command its own slot
+		seed = 2166136261u;
+		while (!placeCommands(seed))
+			{ seed++; }
+	}
+
+	//returns the record of a command, or nullptr if the command does not exist
+	constexpr const CommandRecord<Machine>* find(std::string_view command) const
+	{
+		int index = slots[hashCommand(command, seed) % TABLESIZE];
+
+		if (index != -1 && commandRecords<Machine>[index].name == command)
+			{ return &commandRecords<Machine>[index]; }
+
+		return nullptr;
+	}
 };
 
+template <typename Machine>
+constexpr CommandTable<Machine> commandTable;
+
+//the currency every machine is built for, which another can replace when compiling, such as with /DVENDING_CURRENCY=Euro
+#ifndef VENDING_CURRENCY
+#define VENDING_CURRENCY UsDollar
+#endif
+using VendingMachine = BasicVendingMachine<VENDING_CURRENCY>;
+
+static_assert(commandTable<VendingMachine>.find("COLA") == &commandRecords<VendingMachine>[4], "the command table must find every command");
+
+
+
+//*********************************************************************
+//Creates an empty inventory with room for the given amount of products
+//*********************************************************************
+template <typename Currency>
+BasicVendingMachine<Currency>::Inventory::Inventory(int products)
+{
+	setProducts(products);
+}
+
+//**********************************************************
+//Copies the counts held by another inventory into a new one
+//**********************************************************
+template <typename Currency>
+BasicVendingMachine<Currency>::Inventory::Inventory(const Inventory& other)
+{
+	*this = other;
+}
+
+//******************************************************************************************
+//Makes room for the given amount of products with none in stock, before any session uses it
+//******************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::Inventory::setProducts(int products)
+{
+	//a machine selling from a shared inventory never uses its own, so it is left without any products
+	cola.reset(products > 0 ? new std::atomic<int>[products] : nullptr);
+	amountOfCola = products;
+	for (int i = 0; i < products; i++) { cola[i] = 0; }
+}
+
+//*******************************************
+//Copies the counts held by another inventory
+//*******************************************
+template <typename Currency>
+typename BasicVendingMachine<Currency>::Inventory& BasicVendingMachine<Currency>::Inventory::operator=(const Inventory& other)
+{
+	for (int i = 0; i < AMOUNTOFCOINS; i++) { coins[i] = other.coins[i].load(); }
+	for (int i = 0; i < AMOUNTOFBILLS; i++) { bills[i] = other.bills[i].load(); }
+	if (amountOfCola != other.amountOfCola) { setProducts(other.amountOfCola); }
+	for (int i = 0; i < amountOfCola; i++) { cola[i] = other.cola[i].load(); }
+	cups = other.cups.load();
+	changeVersion = other.changeVersion.load();
+
+	return *this;
+}
+
+//**********************************************************
+//Returns the value in cents of all the coins and bills held
+//**********************************************************
+template <typename Currency>
+long long BasicVendingMachine<Currency>::Inventory::heldValue() const
+{
+	//summed wider than a count, as a full machine can hold more cents than an int holds
+	long long value = 0;
+	unroll<AMOUNTOFCOINS>([&](auto i) { value += static_cast<long long>(coins[i]) * COINVALUES[i]; });
+	unroll<AMOUNTOFBILLS>([&](auto i) { value += static_cast<long long>(bills[i]) * BILLVALUES[i]; });
+
+	return value;
+}
+
+//*****************************************************************************************
+//Takes an amount from a count without a lock, failing rather than letting it go below zero
+//*****************************************************************************************
+template <typename Currency>
+bool BasicVendingMachine<Currency>::Inventory::take(std::atomic<int>& count, int amount)
+{
+	int current = count.load();
+
+	//retries whenever another session changed the count between reading and taking
+	do {
+		if (current < amount) { return false; }
+	} while (!count.compare_exchange_weak(current, current - amount));
+
+	return true;
+}
+
+//*****************************************************************************************
+//Takes up to an amount from a count without a lock and returns how much was actually taken
+//*****************************************************************************************
+template <typename Currency>
+int BasicVendingMachine<Currency>::Inventory::takeUpTo(std::atomic<int>& count, int amount)
+{
+	int current = count.load();
+	int taken;
+
+	do {
+		taken = std::min(current, amount);
+	} while (!count.compare_exchange_weak(current, current - taken));
+
+	return taken;
+}
+
+//********************************************************************
+//Splits a line into at most MAXTOKENS tokens that point into the line
+//********************************************************************
+void CommandTokens::split(const std::string& line)
+{
+	const char* whitespace = " \t\n\v\f\r";
+	std::string_view remaining(line);
+	count = 0;
+
+	//stores each token until the line is exhausted or enough tokens were found to reject it
+	while (count < MAXTOKENS) {
+		std::size_t start = remaining.find_first_not_of(whitespace);
+		if (start == std::string_view::npos) { break; }
+
+		remaining.remove_prefix(start);
+		std::size_t length = std::min(remaining.find_first_of(whitespace), remaining.size());
+		token[count++] = remaining.substr(0, length);
+		remaining.remove_prefix(length);
+	}
+}
+
+//********************************************************************
+//Converts a token to upper case inside the line the token points into
+//********************************************************************
+void CommandTokens::toUpper(std::string& line, int index)
+{
+	if (index >= count) { return; }
+
+	//finds where the token is held inside the line
+	std::size_t offset = token[index].data() - line.data();
+	for (std::size_t i = offset; i < offset + token[index].size(); i++)
+		{ line[i] = static_cast<char>(toupper(static_cast<unsigned char>(line[i]))); }
+}
+
+//*****************************************************************
+//Returns a token, or an empty token if the line did not contain it
+//*****************************************************************
+std::string_view CommandTokens::operator[](int index) const
+{
+	if (index < count)
+		{ return token[index]; }
+
+	return std::string_view();
+}
+
+//**********************************************************************
+//Creates a machine that displays everything it does on the given stream
+//**********************************************************************
+template <typename Currency>
+BasicVendingMachine<Currency>::BasicVendingMachine(std::ostream& sink)
+	: output(&sink)
+{
+}
+
+//*****************************************************************************************
+//Creates a machine that sells from an inventory shared with other machines, such as kiosks
+//*****************************************************************************************
+template <typename Currency>
+BasicVendingMachine<Currency>::BasicVendingMachine(Inventory& shared, std::ostream& sink)
+	: ownInventory(0), sharedInventory(&shared), output(&sink)
+{
+}
+
+//*****************************************************************************************************
+//Runs a line for one of many customers the machine serves in turn, with their deposit, mode and output
+//*****************************************************************************************************
+template <typename Currency>
+bool BasicVendingMachine<Currency>::serve(Customer& customer, std::string_view line, std::ostream& customerOutput)
+{
+	//a customer must bring a deposit, or every customer's money would be mixed in the machine's own
+	assert(customer.deposit != nullptr);
+
+	//the machine's own mode and output are set aside while the customer's are used
+	std::ostream* ownOutput = output;
+	bool ownServiceMode = serviceMode;
+	bool ownRunProgram = runProgram;
+	customerDeposit = customer.deposit;
+	output = &customerOutput;
+	serviceMode = customer.serviceMode;
+	runProgram = true;
+
+	bool succeeded = parseCommand(line);
+
+	customer.serviceMode = serviceMode;
+	customer.exited = !runProgram;
+	customerDeposit = nullptr;
+	output = ownOutput;
+	serviceMode = ownServiceMode;
+	runProgram = ownRunProgram;
+
+	return succeeded;
+}
 
 //************************
 //Handles the coin command
 //************************
-void VendingMachine::coinCmd(std::string option)
+template <typename Currency>
+void BasicVendingMachine<Currency>::coinCmd(std::string_view option)
 {
 	//gets the index of the coins array that corresponds to the string given
 	int index = convertStringCoinToInt(option);
 
 	//deposits the coin into the buffer if it is a valid denomination
 	if (index >= 0 && index < AMOUNTOFCOINS) {
-		coinsBuffer[index] += 1;
-		std::cout << "Added 1 " << option << "-denomination COIN!\n";
+		depositCoin(index, option);
 	}
 
 	//outputs an error if the coin is not a valid denomination
 	else {
-		std::cout << option << " is not a valid parameter for the COIN command" << '\n';
+		errorStream() << option << " is not a valid parameter for the COIN command" << '\n';
 	}
 }
 
 //************************
 //Handles the bill command
 //************************
-void VendingMachine::billCmd(std::string option)
+template <typename Currency>
+void BasicVendingMachine<Currency>::billCmd(std::string_view option)
 {
 	//gets the index of the bills array that corresponds to the string given
 	int index = convertStringBillToInt(option);
 
 	//deposits the bill into the buffer if it is a valid denomination
 	if (index >= 0 && index < AMOUNTOFBILLS) {
-		billsBuffer[index] += 1;
-		std::cout << "Added 1 " << option << "-denomination BILL!\n";
+		depositBill(index, option);
 	}
 
 	//outputs an error if the bill is not a valid denomination
 	else {
-		std::cout << option << " is not a valid parameter for the BILL command" << '\n';
+		errorStream() << option << " is not a valid parameter for the BILL command" << '\n';
 	}
 }
 
 //************************
 //Handles the cola command
 //************************
-void VendingMachine::colaCmd(std::string option, std::string switchParameter)
+template <typename Currency>
+void BasicVendingMachine<Currency>::colaCmd(std::string_view option, std::string_view switchParameter)
+{
+	int colaIndex = convertStringColaToInt(option); //looked up once for every check that follows
+
+	//buys the cola if a valid cola was entered
+	if (colaIndex >= 0) {
+		buyCola(colaIndex, option, switchParameter);
+	}
+
+	//displays that the requested cola is not valid
+	else {
+		errorStream() << option << " is not a valid cola type" << '\n';
+	}
+}
+
+//*************************************************************************************************
+//Deposits a coin by its index, repeating the name it was deposited by, which must already be valid
+//*************************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::depositCoin(int index, std::string_view option)
+{
+	Deposit& paid = deposit();
+	paid.coinsBuffer[index] += 1;
+	paid.bufferValue += COINVALUES[index];
+	if (analytics != nullptr) { analytics->recordDeposit(index); }
+	*output << "Added 1 " << option << "-denomination COIN!\n";
+}
+
+//*************************************************************************************************
+//Deposits a bill by its index, repeating the name it was deposited by, which must already be valid
+//*************************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::depositBill(int index, std::string_view option)
+{
+	Deposit& paid = deposit();
+	paid.billsBuffer[index] += 1;
+	paid.bufferValue += BILLVALUES[index];
+	if (analytics != nullptr) { analytics->recordDeposit(AMOUNTOFCOINS + index); }
+	*output << "Added 1 " << option << "-denomination BILL!\n";
+}
+
+//*****************************************************************************************
+//Buys the cola in a slot, which must already be valid, once every requirement has been met
+//*****************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::buyCola(int colaIndex, std::string_view option, std::string_view switchParameter)
 {
 	//used to calculate whether or not enough money was inserted
 	int costOfCola = PRICE;
@@ -121,263 +648,700 @@ void VendingMachine::colaCmd(std::string option, std::string switchParameter)
 	//the following statements check if all requirements are met to dispense cola//
 	///////////////////////////////////////////////////////////////////////////////
 
-	//checks if a valid cola was entered
-	if (checkForValidCola(option)) {
+	//checks if enough money was inserted
+	if (value >= costOfCola) {
 
-		//checks if enough money was inserted
-		if (value >= costOfCola) {
+		//checks if a cup is available
+		if (inventory().cups > 0) {
 
-			//checks if a cup is available
-			if (cups > 0) {
+			//checks if change can be made and takes it out of the inventory so no other session can hand it out
+			ChangePlan changePlan;
+			if (reserveChange(changePlan)) {
 
-				//checks if change can be made
-				if (checkIfChangeAvailable(value)) {
+				//checks if the cola requested is available
+				if (checkForAvailableCola(colaIndex)) {
 
-					//checks if the cola requested is available
-					if (checkForAvailableCola(option)) {
-
-						//dispenses the cola if all requirements are met
-						dispenseCola(convertStringColaToInt(option), option, switchParameter);
-					}
+					//dispenses the cola if all requirements are met
+					dispenseCola(colaIndex, option, switchParameter, changePlan);
+				}
 
 	//////////////////////////////////////////////////////////////////////////////
 	//displays an appropriate error message if any of the previous checks failed//
 	//////////////////////////////////////////////////////////////////////////////
 
-					//displays that the requested cola is not available
-					else {
-						std::cout << option << " cola is not avaiable" << '\n';
-					}
-				}
-
-				//displays that the machine is unable to make enough change
+				//displays that the requested cola is not available
 				else {
-					std::cout << "Insufficient change avaiable! Returning your money...\n";
-					returnCmd();
+					giveBackChange(changePlan);
+					statistics.soldOut++;
+					errorStream() << option << " cola is not avaiable" << '\n';
 				}
 			}
 
-			//displays that there are not enough cups available
+			//displays that the machine is unable to make enough change
 			else {
-				std::cout << "Insufficient cups avaiable! Returning your money...\n";
+				statistics.noChange++;
+				errorStream() << "Insufficient change avaiable! Returning your money...\n";
 				returnCmd();
 			}
 		}
 
-		//displays that not enough money was entered and shows the current amount entered
+		//displays that there are not enough cups available
 		else {
-			std::cout << "Insufficient funds! Enter more money\n";
-			double fullAmount = (coinsBuffer[0] * 0.05) + (coinsBuffer[1] * 0.10) + (coinsBuffer[2] * 0.25) + (billsBuffer[0] * 1) + (billsBuffer[1] * 5);
-			const int width = 30;
-
-			std::cout << std::setprecision(2) << std::fixed;
-			std::cout << std::setw(width - 1) << std::left << "  Amount Deposited" << "$" << fullAmount << '\n';
+			statistics.noCups++;
+			errorStream() << "Insufficient cups avaiable! Returning your money...\n";
+			returnCmd();
 		}
 	}
 
-	//displays that the requested cola is not valid
+	//displays that not enough money was entered and shows the current amount entered
 	else {
-		std::cout << option << " is not a valid cola type" << '\n';
+		errorStream() << "Insufficient funds! Enter more money\n";
+		double fullAmount = value / 100.0;
+		const int width = 30;
+
+		*output << std::setprecision(2) << std::fixed;
+		*output << std::setw(width - 1) << std::left << "  Amount Deposited" << Currency::SYMBOL << fullAmount << '\n';
 	}
 }
 
 //**************************
 //Handles the return command
 //**************************
-void VendingMachine::returnCmd()
+template <typename Currency>
+void BasicVendingMachine<Currency>::returnCmd()
 {
 
+	Deposit& paid = deposit();
 	bool returnedMoney = false;
+	if (paid.bufferValue > 0) { logEvent(EVENTREFUND, 0, 0, paid.bufferValue); }
 
 	//"returns" the held coins
 	for (int i = 0; i < AMOUNTOFCOINS; i++) {
-		if (coinsBuffer[i] > 0) { returnedMoney = true; }
-		coinsBuffer[i] = 0;
+		if (paid.coinsBuffer[i] > 0) { returnedMoney = true; }
+		paid.coinsBuffer[i] = 0;
 	}
 
 	//"returns" the held bills
 	for (int i = 0; i < AMOUNTOFBILLS; i++) {
-		if (billsBuffer[i] > 0) { returnedMoney = true; }
-		billsBuffer[i] = 0;
+		if (paid.billsBuffer[i] > 0) { returnedMoney = true; }
+		paid.billsBuffer[i] = 0;
 	}
+	paid.bufferValue = 0;
 	
 	//displays whether or not any money was returned
 	if (returnedMoney) 
-		{ std::cout << "Returned all money\n"; }
+		{ *output << "Returned all money\n"; }
 	else 
-		{ std::cout << "No money to return!\n"; }
+		{ *output << "No money to return!\n"; }
 	
 }
 
 //**************************
 //Handles the status command
 //**************************
-void VendingMachine::statusCmd()
+template <typename Currency>
+void BasicVendingMachine<Currency>::statusCmd()
 {
-	//calculates the amount currently deposited into the machine
-	double fullAmount = (coinsBuffer[0] * 0.05) + (coinsBuffer[1] * 0.10) + (coinsBuffer[2] * 0.25) + (billsBuffer[0] * 1) + (billsBuffer[1] * 5);
-	
 	//used to assign the width of each label
 	const int width = 28;
-
-	//displays the status in a formated table
-	std::cout << std::setprecision(2) << std::fixed;
-	std::cout << std::setw(width) << std::left << "   Amount Deposited" << " = $" << fullAmount << '\n';
-	std::cout << std::setw(width) << std::left << "   Total One Dollar Bills" << " =  " << bills[0] << '\n';
-	std::cout << std::setw(width) << std::left << "   Total Five Dollar Bills" << " =  " << bills[1] << '\n';
-	std::cout << std::setw(width) << std::left << "   Total Nickels" << " =  " << coins[0] << '\n';
-	std::cout << std::setw(width) << std::left << "   Total Dimes" << " =  " << coins[1] << '\n';
-	std::cout << std::setw(width) << std::left << "   Total Quarters" << " =  " << coins[2] << '\n';
-	std::cout << std::setw(width) << std::left << "   Total Coke" << " =  " << cola[0] << '\n';
-	std::cout << std::setw(width) << std::left << "   Total Pepsi" << " =  " << cola[1] << '\n';
-	std::cout << std::setw(width) << std::left << "   Total Sprite" << " =  " << cola[2] << '\n';
-	std::cout << std::setw(width) << std::left << "   Total Fanta" << " =  " << cola[3] << '\n';
-	std::cout << std::setw(width) << std::left << "   Total Faygo" << " =  " << cola[4] << '\n';
-	std::cout << std::setw(width) << std::left << "   Total Cups" << " =  " << cups << '\n';
+	const int nameWidth = width - 9; //the width left after "   Total "
+	const int rows = AMOUNTOFDENOMINATIONS + catalog->size() + 2;
+
+	//lays the whole table out in the report buffer, which only grows the first time a catalog this large is reported
+	statusReport.clear();
+	statusReport.reserve(rows * (width + 16));
+	statusReport.appendPadded("   Amount Deposited", width);
+	statusReport.append(" = ");
+	statusReport.append(Currency::SYMBOL);
+	statusReport.appendMoney(deposit().bufferValue);
+	statusReport.append("\n");
+
+	Inventory& held = inventory();
+	auto appendRow = [&](std::string_view name, int count) {
+		statusReport.append("   Total ");
+		statusReport.appendPadded(name, nameWidth);
+		statusReport.append(" =  ");
+		statusReport.appendNumber(count);
+		statusReport.append("\n");
+	};
+	unroll<AMOUNTOFBILLS>([&](auto i) { appendRow(Currency::BILLS[i].statusLabel, held.bills[i]); });
+	unroll<AMOUNTOFCOINS>([&](auto i) { appendRow(Currency::COINS[i].statusLabel, held.coins[i]); });
+	for (int i = 0; i < catalog->size(); i++)
+		{ appendRow(catalog->name(i), held.cola[i]); }
+	appendRow("Cups", held.cups);
+
+	//displays the status in a formated table with a single write
+	statusReport.writeTo(*output);
 }
 
 //**************************
 //Handles the unlock command
 //**************************
-void VendingMachine::unlockCmd(std::string option)
+template <typename Currency>
+void BasicVendingMachine<Currency>::unlockCmd(std::string_view option)
 {
 	//unlocks the machine if the correct password is given
-	if (option == password) { 
+	if (hashPassword(option) == passwordHash) { 
 		serviceMode = true;
-		std::cout << "Unlocked!" << '\n';
+		logEvent(EVENTUNLOCK, 0, 0, 0);
+		*output << "Unlocked!" << '\n';
 	}
 
 	//displays an error message if the incorrect password is given
-	else { std::cout << "Invalid password, try again" << '\n'; }
+	else { errorStream() << "Invalid password, try again" << '\n'; }
 }
 
 //************************
 //Handles the lock command
 //************************
-void VendingMachine::lockCmd(std::string option)
+template <typename Currency>
+void BasicVendingMachine<Currency>::lockCmd(std::string_view option)
 {
 	//locks the machine if the correct password is given
-	if (option == password) { 
+	if (hashPassword(option) == passwordHash) { 
 		serviceMode = false;
-		std::cout << "Locked" << '\n';
+		logEvent(EVENTLOCK, 0, 0, 0);
+		*output << "Locked" << '\n';
 	}
 
 	//displays an error message if the incorrect password is given
-	else { std::cout << "Invalid password, try again" << '\n'; }
+	else { errorStream() << "Invalid password, try again" << '\n'; }
 }
 
 //************************
 //Handles the help command
 //************************
-void VendingMachine::helpCmd()
+template <typename Currency>
+void BasicVendingMachine<Currency>::helpCmd()
 {
+	const int MAXLISTEDCOLAS = 10;
+
+	//lists the products to choose from, unless there are too many to list
+	auto listColas = [&]() {
+		if (catalog->size() <= MAXLISTEDCOLAS) {
+			for (int i = 0; i < catalog->size(); i++) {
+				for (char c : catalog->name(i))
+					{ *output << static_cast<char>(tolower(static_cast<unsigned char>(c))); }
+				*output << ' ';
+			}
+		}
+		else { *output << "one of the " << catalog->size() << " products in the catalog "; }
+	};
+
+	//lists the currency's coins by their other names and then their names
+	auto listCoins = [&]() {
+		const char* separator = "";
+		unroll<AMOUNTOFCOINS>([&](auto i) {
+			if (Currency::COINS[i].alias != "") {
+				*output << separator << Currency::COINS[i].alias;
+				separator = " ";
+			}
+		});
+		unroll<AMOUNTOFCOINS>([&](auto i) {
+			*output << separator;
+			for (char c : Currency::COINS[i].name)
+				{ *output << static_cast<char>(tolower(static_cast<unsigned char>(c))); }
+			separator = " ";
+		});
+	};
+
+	//lists the currency's bills by their names
+	auto listBills = [&]() {
+		unroll<AMOUNTOFBILLS>([&](auto i) { *output << (i == 0 ? "" : " ") << Currency::BILLS[i].name; });
+	};
 
 	//displays all commands in serivce mode
 	if (serviceMode == true) {
-		std::cout << "Commands in Service Mode are:" << '\n';
-		std::cout << "Coin <value> where value is 5 10 25 nickel dime quarter" << '\n';
-		std::cout << "Bill <value> where value is 1 5" << '\n';
-		std::cout << "Cola <value> where value is coke pepsi sprite fanta faygo  [-no_ice]" << '\n';
-		std::cout << "Return" << '\n';
-		std::cout << "Status" << '\n';
-		std::cout << "Exit" << '\n';
-		std::cout << "Add [COLA|CUPS] brand <quantity>" << '\n';
-		std::cout << "Add|Remove [Coins|Bills] <denomination> <quantity>" << '\n';
-		std::cout << "Lock [password]" << '\n';
+		*output << "Commands in Service Mode are:" << '\n';
+		*output << "Coin <value> where value is ";
+		listCoins();
+		*output << '\n' << "Bill <value> where value is ";
+		listBills();
+		*output << '\n' << "Cola <value> where value is ";
+		listColas();
+		*output << " [-no_ice]" << '\n';
+		*output << "Return" << '\n';
+		*output << "Status" << '\n';
+		*output << "Exit" << '\n';
+		*output << "Add [COLA|CUPS] brand <quantity>" << '\n';
+		*output << "Add|Remove [Coins|Bills] <denomination> <quantity>" << '\n';
+		*output << "Lock [password]" << '\n';
+		*output << "Allocs" << '\n';
+		*output << "Metrics [reset]" << '\n';
+		*output << "Sales [window] where window is a number of minutes, or of hours or days such as 6h or 7d" << '\n';
+		*output << "Alerts [COLA|CUPS|Coins|Bills] [brand|denomination] <threshold>" << '\n';
+		*output << "Restock <file> where each line of file is COLA,brand,quantity or CUPS,,quantity or Coins|Bills,denomination,quantity" << '\n';
 	}
 
 	//displays all commands in normal mode
 	else {
-		std::cout << "Commands in Normal Mode are:" << '\n';
-		std::cout << "Coin <value> where value is 5 10 25 nickel dime quarter" << '\n';
-		std::cout << "Bill <value> where value is 1 5" << '\n';
-		std::cout << "Cola <value> where value is coke pepsi sprite fanta faygo  [-no_ice]" << '\n';
-		std::cout << "Return" << '\n';
-		std::cout << "Status" << '\n';
-		std::cout << "Exit" << '\n';
-		std::cout << "Unlock [password]" << '\n';
+		*output << "Commands in Normal Mode are:" << '\n';
+		*output << "Coin <value> where value is ";
+		listCoins();
+		*output << '\n' << "Bill <value> where value is ";
+		listBills();
+		*output << '\n' << "Cola <value> where value is ";
+		listColas();
+		*output << " [-no_ice]" << '\n';
+		*output << "Return" << '\n';
+		*output << "Status" << '\n';
+		*output << "Exit" << '\n';
+		*output << "Unlock [password]" << '\n';
+	}
+}
+
+//*******************************************************************************
+//Handles the allocs command, which shows how many heap allocations commands made
+//*******************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::allocsCmd()
+{
+#ifdef VENDING_COUNT_ALLOCATIONS
+	*output << commandAllocations << " heap allocations in the last " << commandsCounted << " commands, "
+		<< heapAllocations.load(std::memory_order_relaxed) << " since the program started" << '\n';
+
+	//starts counting again from this command
+	commandAllocations = 0;
+	commandsCounted = 0;
+#else
+	errorStream() << "Allocations are not counted, build with VENDING_COUNT_ALLOCATIONS to count them" << '\n';
+#endif
+}
+
+//***********************************************************************************************
+//Handles the metrics command, which shows how long each command took or starts timing them again
+//***********************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::metricsCmd([[maybe_unused]] bool reset)
+{
+#if VENDING_METRICS
+	const int NUMOFCOMMANDS = sizeof(commandRecords<BasicVendingMachine>) / sizeof(commandRecords<BasicVendingMachine>[0]);
+
+	if (metrics == nullptr) {
+		errorStream() << "Commands are not timed on this machine" << '\n';
+		return;
+	}
+
+	if (reset) {
+		for (int i = 0; i < NUMOFCOMMANDS; i++)
+			{ metrics->latency[i].reset(); }
+		*output << "Metrics reset" << '\n';
+		return;
+	}
+
+	//converts the cycle counter's ticks to nanoseconds for display
+	double ticksPerNanosecond = cycleCounterRate();
+	auto nanoseconds = [&](std::uint64_t ticks) { return static_cast<long long>(ticks / ticksPerNanosecond); };
+
+	//displays the latency of every command run since the last reset in a formated table
+	*output << std::left << std::setw(10) << "Command" << std::right << std::setw(10) << "Count" << std::setw(10) << "p50 ns"
+		<< std::setw(10) << "p99 ns" << std::setw(10) << "p99.9 ns" << std::setw(10) << "max ns" << '\n';
+	for (int i = 0; i < NUMOFCOMMANDS; i++) {
+		const LatencyHistogram& latency = metrics->latency[i];
+		if (latency.count() == 0) { continue; }
+
+		*output << std::left << std::setw(10) << commandRecords<BasicVendingMachine>[i].name << std::right << std::setw(10) << latency.count()
+			<< std::setw(10) << nanoseconds(latency.percentile(0.5)) << std::setw(10) << nanoseconds(latency.percentile(0.99))
+			<< std::setw(10) << nanoseconds(latency.percentile(0.999)) << std::setw(10) << nanoseconds(latency.maximum()) << '\n';
+	}
+	*output << std::left;
+#else
+	errorStream() << "Commands are not timed, build with VENDING_METRICS=1 to time them" << '\n';
+#endif
+}
+
+//********************************************************************************************************
+//Handles the sales command, which shows what sold and was deposited over the last given amount of minutes
+//********************************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::salesCmd(int minutes)
+{
+	const int width = 34;
+	const int MAXTOPSELLERS = 5;
+
+	if (analytics == nullptr) {
+		errorStream() << "Sales are not counted on this machine" << '\n';
+		return;
+	}
+
+	//counts everything over the whole buckets that cover the window, without going over each sale
+	int covered = analytics->readWindow(minutes);
+	std::uint64_t sold = analytics->totalSales();
+
+	//lays the report out in the status report's buffer, with the rate given per hour of the minutes counted
+	statusReport.clear();
+	auto appendRow = [&](std::string_view label, std::string_view name, std::uint64_t count) {
+		statusReport.append("   ");
+		statusReport.append(label);
+		statusReport.appendPadded(name, width - 3 - static_cast<int>(label.size()));
+		statusReport.append(" =  ");
+		statusReport.appendNumber(static_cast<long long>(count));
+		statusReport.append("\n");
+	};
+	appendRow("Minutes Counted", "", static_cast<std::uint64_t>(covered));
+	appendRow("Sales", "", sold);
+	statusReport.appendPadded("   Sales Per Hour", width);
+	statusReport.append(" =  ");
+	statusReport.appendHundredths(static_cast<long long>(sold * 6000 / covered));
+	statusReport.append("\n");
+	statusReport.appendPadded("   Revenue", width);
+	statusReport.append(" = ");
+	statusReport.append(Currency::SYMBOL);
+	statusReport.appendMoney(static_cast<long long>(sold * PRICE));
+	statusReport.append("\n");
+
+	const int* places;
+	int sellers = analytics->topSellers(MAXTOPSELLERS, places);
+	for (int i = 0; i < sellers; i++)
+		{ appendRow("Top ", catalog->name(places[i]), analytics->sales(places[i])); }
+	unroll<AMOUNTOFBILLS>([&](auto i) { appendRow("Deposited ", Currency::BILLS[i].statusLabel, analytics->deposits(AMOUNTOFCOINS + i)); });
+	unroll<AMOUNTOFCOINS>([&](auto i) { appendRow("Deposited ", Currency::COINS[i].statusLabel, analytics->deposits(i)); });
+
+	statusReport.writeTo(*output);
+}
+
+//***********************************************************************************************************
+//Handles the alerts command, which shows the items that are low and every alert raised since it was last run
+//***********************************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::alertsCmd()
+{
+	const int width = 34;
+
+	if (alerts == nullptr) {
+		errorStream() << "Stock is not watched on this machine" << '\n';
+		return;
 	}
+
+	//lists the low items from the top of the heap, furthest below their thresholds first
+	statusReport.clear();
+	const std::vector<int>& low = alerts->lowItems();
+	for (int item : low) {
+		statusReport.append("   Low ");
+		statusReport.appendPadded(stockItemName<Currency>(*catalog, item), width - 7);
+		statusReport.append(" =  ");
+		statusReport.appendNumber(alerts->count(item));
+		statusReport.append(" of ");
+		statusReport.appendNumber(alerts->threshold(item));
+		statusReport.append("\n");
+	}
+	if (low.empty()) { statusReport.append("No items are low\n"); }
+
+	//the alerts raised since they were last read, oldest first
+	StockAlert alert;
+	while (alerts->nextRecent(alert)) {
+		statusReport.append(stockItemName<Currency>(*catalog, alert.item));
+		statusReport.append(alert.low ? " went low with " : " was restocked to ");
+		statusReport.appendNumber(alert.count);
+		statusReport.append(alert.low ? " left\n" : "\n");
+	}
+
+	statusReport.writeTo(*output);
 }
 
-//*********************************************************
-//Calculates and dispenses the appropriate amount of change
-//*********************************************************
-void VendingMachine::dispenseChange()
+//**********************************************************************************
+//Sets how few of a product, the cups or a coin or bill may be left before it is low
+//**********************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::thresholdCmd(std::string_view option, std::string_view switchParameter, std::string_view switchParameter2)
 {
-	int amountPaid = convertBufferToValue(); //amount of money deposited
-	int desiredChange = amountPaid - PRICE; //amount of money that the change needs to equal
-	int changeMade = 0; //the amount of change that is made
+	int item = -1;
+	std::string_view threshold = switchParameter2;
 
-	//dispenses $5 while the change needed is more or equal to that
-	while (desiredChange >= (changeMade + 500) && bills[1] > 0) {
-		bills[0] -= 1;
-		changeMade += 500;
+	if (alerts == nullptr) {
+		errorStream() << "Stock is not watched on this machine" << '\n';
+		return;
+	}
+
+	//finds the item the threshold is for, with the cups taking their threshold in place of a brand or denomination
+	if (option == "COLA") {
+		item = convertStringColaToInt(switchParameter);
+		if (item < 0) {
+			errorStream() << switchParameter << " is not a valid cola" << '\n';
+			return;
+		}
 	}
-	//dispenses $1 while the change needed is more or equal to that
-	while (desiredChange >= (changeMade + 100) && bills[0] > 0) {
-		bills[0] -= 1;
-		changeMade += 100;
+	else if (option == "CUPS") {
+		if (switchParameter2 != "") {
+			errorStream() << switchParameter2 << " is not a valid parameter for the ALERTS command" << '\n';
+			return;
+		}
+		item = alerts->cupsItem();
+		threshold = switchParameter;
 	}
-	//dispenses $0.25 while the change needed is more or equal to that
-	while (desiredChange >= (changeMade + 025) && coins[2] > 0) {
-		coins[2] -= 1;
-		changeMade += 25;
+	else if (option == "COINS" || option == "BILLS") {
+		int index = (option == "COINS") ? convertStringCoinToInt(switchParameter) : convertStringBillToInt(switchParameter);
+		int count = (option == "COINS") ? AMOUNTOFCOINS : AMOUNTOFBILLS;
+		if (index < 0 || index >= count) {
+			errorStream() << switchParameter << " is not a valid denomination" << '\n';
+			return;
+		}
+		item = alerts->denominationItem(option == "COINS" ? index : AMOUNTOFCOINS + index);
 	}
-	//dispenses $0.10 while the change needed is more or equal to that
-	while (desiredChange >= (changeMade + 010) && coins[1] > 0) {
-		coins[1] -= 1;
-		changeMade += 10;
+	else {
+		errorStream() << "The " << option << " option is not valid for the ALERTS command" << '\n';
+		return;
 	}
-	//dispenses $0.05 while the change needed is more or equal to that
-	while (desiredChange >= (changeMade + 005) && coins[0] > 0) {
-		coins[0] -= 1;
-		changeMade += 5;
+
+	//checks if a valid threshold was given
+	if (threshold == "" || threshold.find_first_not_of("0123456789") != std::string_view::npos) {
+		errorStream() << threshold << " is not a valid threshold" << '\n';
+		return;
 	}
 
-	//adds the deposited buffer change into the actual machine
+	alerts->setThreshold(item, convertStringToNumber(threshold));
+	if (alerts->threshold(item) == 0)
+		{ *output << stockItemName<Currency>(*catalog, item) << " is never low" << '\n'; }
+	else
+		{ *output << stockItemName<Currency>(*catalog, item) << " is low when fewer than " << alerts->threshold(item) << " are left" << '\n'; }
+}
+
+//*************************************************************************************************************
+//Handles the restock command, which adds everything a manifest lists at once, or nothing if any row is invalid
+//*************************************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::restockCmd(std::string_view fileName)
+{
+	const int MAXRESTOCKQUANTITY = 100000; //the most of one item a manifest may add
+	const int MAXREPORTEDERRORS = 10;
+	Inventory& held = inventory();
+	const int products = held.amountOfCola;
+	const int cupsItem = products;
+	const int firstCoin = products + 1;
+	const int firstBill = firstCoin + AMOUNTOFCOINS;
+
+	ManifestReader manifest{ std::string(fileName) };
+	if (!manifest.isOpen()) {
+		errorStream() << "Unable to open " << fileName << '\n';
+		return;
+	}
+
+	//reports an invalid row, showing no more than the first few
+	int rows = 0;
+	int errors = 0;
+	auto invalid = [&](int line, std::string_view value, std::string_view reason) {
+		if (++errors <= MAXREPORTEDERRORS)
+			{ errorStream() << fileName << " line " << line << ": " << value << reason << '\n'; }
+	};
+
+	//returns how many of an item are held now, with the items numbered as their totals are
+	auto heldCount = [&](int item) -> int {
+		if (item < products) { return held.cola[item]; }
+		if (item == cupsItem) { return held.cups; }
+		if (item < firstBill) { return held.coins[item - firstCoin]; }
+		return held.bills[item - firstBill];
+	};
+
+	//adds every row's quantity to its item's total first, so nothing is restocked unless every row is valid
+	restockQuantities.assign(firstBill + AMOUNTOFBILLS, 0);
+	ManifestRow row;
+	while (manifest.nextRow(row)) {
+		if (row.tooLong) {
+			invalid(row.line, "The line", " is too long");
+			continue;
+		}
+
+		//a first row naming its columns is a header
+		std::string_view type = row.fields[0];
+		if (rows == 0 && errors == 0 && type == "ITEM") { continue; }
+		rows++;
+
+		//the cups have no name, so their quantity may follow the type directly
+		std::string_view name = row.fields[1];
+		std::string_view quantity = row.fields[2];
+		if (type == "CUPS" && row.fieldCount == 2) {
+			name = "";
+			quantity = row.fields[1];
+		}
+		else if (row.fieldCount != 3) {
+			invalid(row.line, "The row", " is not item,name,quantity");
+			continue;
+		}
+
+		int item = -1;
+		if (type == "COLA") {
+			item = convertStringColaToInt(name);
+			if (item < 0) { invalid(row.line, name, " is not a valid cola"); }
+		}
+		else if (type == "CUPS") {
+			if (name == "") { item = cupsItem; }
+			else { invalid(row.line, name, " is not a valid parameter for CUPS"); }
+		}
+		else if (type == "COINS") {
+			int index = convertStringCoinToInt(name);
+			if (index >= 0 && index < AMOUNTOFCOINS) { item = firstCoin + index; }
+			else { invalid(row.line, name, " is not a valid denomination"); }
+		}
+		else if (type == "BILLS") {
+			int index = convertStringBillToInt(name);
+			if (index >= 0 && index < AMOUNTOFBILLS) { item = firstBill + index; }
+			else { invalid(row.line, name, " is not a valid denomination"); }
+		}
+		else { invalid(row.line, type, " is not a valid item, such as COLA, CUPS, COINS or BILLS"); }
+		if (item < 0) { continue; }
+
+		//checks if a valid quantity was given, and that the item's total stays within what one manifest may add
+		int amount = 0;
+		std::from_chars_result result = std::from_chars(quantity.data(), quantity.data() + quantity.size(), amount);
+		if (quantity == "" || result.ec != std::errc() || result.ptr != quantity.data() + quantity.size() || amount < 0) {
+			invalid(row.line, quantity, " is not a valid quantity");
+			continue;
+		}
+		if (amount > MAXRESTOCKQUANTITY - restockQuantities[item]) {
+			invalid(row.line, "The row", " brings its item past the most one manifest may add");
+			continue;
+		}
+		if (static_cast<long long>(heldCount(item)) + restockQuantities[item] + amount > INT_MAX) {
+			invalid(row.line, "The row", " brings its item past the most the machine can hold");
+			continue;
+		}
+		restockQuantities[item] += amount;
+	}
+
+	if (errors > 0) {
+		if (errors > MAXREPORTEDERRORS) { errorStream() << "and " << errors - MAXREPORTEDERRORS << " more invalid rows" << '\n'; }
+		errorStream() << "Nothing was restocked from " << fileName << '\n';
+		return;
+	}
+	if (rows == 0) {
+		errorStream() << fileName << " has no rows to restock" << '\n';
+		return;
+	}
+
+	//every row was valid, so each item's total is added in one step and recorded as one event
+	long long colas = 0;
+	long long coins = 0;
+	long long bills = 0;
+	for (int i = 0; i < products; i++) {
+		if (restockQuantities[i] == 0) { continue; }
+		held.cola[i] += restockQuantities[i];
+		colas += restockQuantities[i];
+		logEvent(EVENTRESTOCK, i, restockQuantities[i], 0);
+		checkStock(i);
+	}
+	if (restockQuantities[cupsItem] > 0) {
+		held.cups += restockQuantities[cupsItem];
+		logEvent(EVENTRESTOCK, EVENTITEMCUPS, restockQuantities[cupsItem], 0);
+		if (alerts != nullptr) { checkStock(alerts->cupsItem()); }
+	}
+	unroll<AMOUNTOFCOINS>([&](auto i) {
+		int amount = restockQuantities[firstCoin + i];
+		if (amount == 0) { return; }
+		held.coins[i] += amount;
+		coins += amount;
+		logEvent(EVENTMONEY, i, amount, moneyValue(amount, COINVALUES[i]));
+		if (alerts != nullptr) { checkStock(alerts->denominationItem(i)); }
+	});
+	unroll<AMOUNTOFBILLS>([&](auto i) {
+		int amount = restockQuantities[firstBill + i];
+		if (amount == 0) { return; }
+		held.bills[i] += amount;
+		bills += amount;
+		logEvent(EVENTMONEY, AMOUNTOFCOINS + i, amount, moneyValue(amount, BILLVALUES[i]));
+		if (alerts != nullptr) { checkStock(alerts->denominationItem(AMOUNTOFCOINS + i)); }
+	});
+	if (coins + bills > 0) { held.changeVersion++; }
+
+	*output << "Restocked " << colas << " colas, " << restockQuantities[cupsItem] << " cups, " << coins << " coins and " << bills
+		<< " bills from " << rows << " rows of " << fileName << '\n';
+}
+
+//*****************************************************************************************
+//Dispenses the change that was already taken out of the inventory and keeps the money paid
+//*****************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::dispenseChange([[maybe_unused]] const ChangePlan& changePlan)
+{
+	Inventory& held = inventory();
+	Deposit& paid = deposit();
+
+	//checks that the change taken was planned for the money now being kept
+	assert(changePlan.possible && changePlan.amount == paid.bufferValue - PRICE);
+
+#ifndef NDEBUG
+	int coinsBefore[AMOUNTOFCOINS], billsBefore[AMOUNTOFBILLS];
+	int coinsKept[AMOUNTOFCOINS], billsKept[AMOUNTOFBILLS];
 	for (int i = 0; i < AMOUNTOFCOINS; i++) {
-		coins[i] += coinsBuffer[i];
-		coinsBuffer[i] = 0;
+		coinsBefore[i] = held.coins[i];
+		coinsKept[i] = paid.coinsBuffer[i];
 	}
 	for (int i = 0; i < AMOUNTOFBILLS; i++) {
-		bills[i] += billsBuffer[i];
-		billsBuffer[i] = 0;
+		billsBefore[i] = held.bills[i];
+		billsKept[i] = paid.billsBuffer[i];
+	}
+#endif
+
+	//adds the deposited buffer change into the actual machine
+	unroll<AMOUNTOFCOINS>([&](auto i) {
+		held.coins[i] += paid.coinsBuffer[i];
+		paid.coinsBuffer[i] = 0;
+	});
+	unroll<AMOUNTOFBILLS>([&](auto i) {
+		held.bills[i] += paid.billsBuffer[i];
+		paid.billsBuffer[i] = 0;
+	});
+	paid.bufferValue = 0;
+
+#ifndef NDEBUG
+	//checks that exactly the money deposited went into each coin and bill, which can only be seen when no other session shares them
+	for (int i = 0; i < AMOUNTOFCOINS; i++)
+		{ assert(sharedInventory != nullptr || held.coins[i] - coinsBefore[i] == coinsKept[i]); }
+	for (int i = 0; i < AMOUNTOFBILLS; i++)
+		{ assert(sharedInventory != nullptr || held.bills[i] - billsBefore[i] == billsKept[i]); }
+#endif
+	held.changeVersion++;
+
+	//the change paid out and the money kept may each take a coin or bill across its threshold
+	if (alerts != nullptr) {
+		for (int i = 0; i < AMOUNTOFCOINS + AMOUNTOFBILLS; i++)
+			{ checkStock(alerts->denominationItem(i)); }
 	}
 }
 
 //******************************
 //Dispenses the appropriate cola
 //******************************
-void VendingMachine::dispenseCola(int colaIndex, std::string colaString, std::string switchParameter)
+template <typename Currency>
+void BasicVendingMachine<Currency>::dispenseCola(int colaIndex, std::string_view colaString, std::string_view switchParameter, const ChangePlan& changePlan)
 {
-	//checks if the request cola is in stock
-	if (cola[colaIndex] > 0) {
+	Inventory& held = inventory();
 
-		//Dispenses cola with ice if there is not a switch parameter
-		if (switchParameter == "") {
-			cola[colaIndex] -= 1;
-			cups -= 1;
-			std::cout << "Dispensing " << colaString << " with ice" << '\n';
-			dispenseChange();
-		}
+	//displays an error message if the switch parameter is invalid
+	if (switchParameter != "" && switchParameter != "-NO_ICE") {
+		giveBackChange(changePlan);
+		errorStream() << switchParameter << " is not a valid parameter for the COLA command" << '\n';
+	}
 
-		//Dispenses cola without ice if there is a valid "-no_ice" switch parameter
-		else if (switchParameter == "-NO_ICE") {
-			cola[colaIndex] -= 1;
-			cups -= 1;
-			std::cout << "Dispensing " << colaString << " without ice" << '\n';
-			dispenseChange();
+	//takes the cola and a cup, which another session sharing the inventory may have just taken the last of
+	else if (Inventory::take(held.cola[colaIndex], 1)) {
+		if (Inventory::take(held.cups, 1)) {
+			statistics.sales++;
+			logEvent(EVENTSALE, colaIndex, 1, deposit().bufferValue);
+			if (analytics != nullptr) { analytics->recordSale(colaIndex); }
+			checkStock(colaIndex);
+			if (alerts != nullptr) { checkStock(alerts->cupsItem()); }
+
+			//Dispenses cola with ice if there is not a switch parameter, or without ice for a valid "-no_ice" switch parameter
+			if (switchParameter == "")
+				{ *output << "Dispensing " << colaString << " with ice" << '\n'; }
+			else
+				{ *output << "Dispensing " << colaString << " without ice" << '\n'; }
+			dispenseChange(changePlan);
 		}
 
-		//displays an error message if the switch parameter is invalid
+		//puts the cola back if the last cup was taken
 		else {
-			std::cout << switchParameter << " is not a valid parameter for the COLA command" << '\n';
+			held.cola[colaIndex]++;
+			giveBackChange(changePlan);
+			errorStream() << "Something went wrong. Returning your money..." << '\n';
+			returnCmd();
 		}
 	}
 
 	//displays an error message if the requested cola is not in stock
 	else {
-		std::cout << "Something went wrong. Returning your money..." << '\n';
+		giveBackChange(changePlan);
+		errorStream() << "Something went wrong. Returning your money..." << '\n';
 		returnCmd();
 	}
 }
@@ -385,7 +1349,8 @@ void VendingMachine::dispenseCola(int colaIndex, std::string colaString, std::st
 //*************************************************
 //Adjusts the amount of an item held in the machine
 //*************************************************
-void VendingMachine::adjustItemCountCmd(std::string command, std::string option, std::string switchParameter, std::string switchParameter2)
+template <typename Currency>
+void BasicVendingMachine<Currency>::adjustItemCountCmd(std::string_view command, std::string_view option, std::string_view switchParameter, std::string_view switchParameter2)
 {
 	int quantity;
 	int colaTypeChosen;
@@ -395,32 +1360,24 @@ void VendingMachine::adjustItemCountCmd(std::string command, std::string option,
 
 		//adds a cola
 		if (option == "COLA") {
-			bool validity = false;
-
 			//checks if the string entered is a valid cola type
-			for (int i = 0; i < SIZEOFCOLATYPES; i++) {
-				if (switchParameter == colaTypes[i]) { //checks if the string matches any in the array
-					validity = true;
-					colaTypeChosen = i;
-				}
-			}
+			colaTypeChosen = convertStringColaToInt(switchParameter);
 
 			//proceeds if the string entered was valid
-			if (validity) {
-				bool quantityOnlyDigits = (switchParameter2.find_first_not_of("0123456789") == std::string::npos); //checks for values that aren't numeric
+			if (colaTypeChosen >= 0) {
+				bool quantityOnlyDigits = (switchParameter2.find_first_not_of("0123456789") == std::string_view::npos); //checks for values that aren't numeric
 
 				//checks if a valid quantity was requested
 				if (quantityOnlyDigits) {
 					quantity = convertStringToNumber(switchParameter2);
-					cola[colaTypeChosen] += quantity;
-					std::cout << "Added " << quantity << " " << switchParameter << "!\n";
+					addCola(colaTypeChosen, quantity, switchParameter);
 				}
 
 				//displays an error message if an invalid quantity was requested
-				else { std::cout << switchParameter2 << " is not a valid quantity" << '\n'; }
+				else { errorStream() << switchParameter2 << " is not a valid quantity" << '\n'; }
 			}
 			//displays an error message if an invalid cola was requested
-			else { std::cout << switchParameter << " is not a valid cola" << '\n'; }
+			else { errorStream() << switchParameter << " is not a valid cola" << '\n'; }
 		}
 
 		//adds cups
@@ -429,89 +1386,56 @@ void VendingMachine::adjustItemCountCmd(std::string command, std::string option,
 			//checks if the command contains too many parameters
 			if (switchParameter2 == "") {
 
-				bool quantityOnlyDigits = (switchParameter.find_first_not_of("0123456789") == std::string::npos); //checks for values that aren't numeric
+				bool quantityOnlyDigits = (switchParameter.find_first_not_of("0123456789") == std::string_view::npos); //checks for values that aren't numeric
 
 				//adds the amount of cups requested if the quantity is valid
 				if (quantityOnlyDigits) {
 					quantity = convertStringToNumber(switchParameter);
-					cups += quantity;
-					std::cout << "Added " << quantity << " " << option << "!\n";
+					addCups(quantity);
 				}
 
 				//displays an error message if an invalid quantity was requested
-				else { std::cout << switchParameter << " is not a valid quantity" << '\n'; }
+				else { errorStream() << switchParameter << " is not a valid quantity" << '\n'; }
 			}
 
 			//displays an error message if the command contained too many parameters
-			else { std::cout << switchParameter2 << " is not a valid parameter for the " << command << " command" << '\n'; }
+			else { errorStream() << switchParameter2 << " is not a valid parameter for the " << command << " command" << '\n'; }
 		}
 
 		//displays an error message if the command contained an invalid parameters
-		else { std::cout << "The " << option << " option is not valid for the " << command << " command" << '\n'; }
+		else { errorStream() << "The " << option << " option is not valid for the " << command << " command" << '\n'; }
 	}
 
 	//displays an error message if the user attempts to remove an item
 	else {
-		std::cout << "The " << option << " option is not valid for the " << command << " command" << '\n';
+		errorStream() << "The " << option << " option is not valid for the " << command << " command" << '\n';
 	}
 }
 
 //*********************************************
 //Converts the buffer change to a numeric value
 //*********************************************
-int VendingMachine::convertBufferToValue()
+template <typename Currency>
+int BasicVendingMachine<Currency>::convertBufferToValue()
 {
-	//holds the actual numeric value of the change
-	int value = 0;
-
-	//temporary variables
-	int numOfBills, numOfFiveBills, numOfNickels, numOfDimes, numOfQuarters;
-	numOfBills = billsBuffer[0];
-	numOfFiveBills = billsBuffer[1];
-	numOfNickels = coinsBuffer[0];
-	numOfDimes = coinsBuffer[1];
-	numOfQuarters = coinsBuffer[2];
-
-	//checks value of all inserted bills
-	while (numOfFiveBills > 0) {
-		numOfFiveBills -= 1;
-		value += 500;
-	}
-	while (numOfBills > 0) {
-		numOfBills -= 1;
-		value += 100;
-	}
-
-	//checks value of all inserted coins
-	while (numOfQuarters > 0) {
-		numOfQuarters -= 1;
-		value += 25;
-	}
-	while (numOfDimes > 0) {
-		numOfDimes -= 1;
-		value += 10;
-	}
-	while (numOfNickels > 0) {
-		numOfNickels -= 1;
-		value += 5;
-	}
-
-	return value;
+	//the value is kept up to date as money is deposited, returned and spent
+	return deposit().bufferValue;
 }
 
 
 //*************************************************
 //Converts a coin's name to its corresponding index 
 //*************************************************
-int VendingMachine::convertStringCoinToInt(std::string s)
+template <typename Currency>
+int BasicVendingMachine<Currency>::convertStringCoinToInt(std::string_view s)
 {
 	//returns -1 if the string is invalid
 	int value = -1;
 
-	if (s == "NICKEL" || s == "5") { value = 0; }
-	else if (s == "DIME" || s == "10") { value = 1; }
-	else if (s == "QUARTER"|| s == "25") { value = 2; }
-
+	//checks the string against the name and other name of each of the currency's coins
+	unroll<AMOUNTOFCOINS>([&](auto i) {
+		if (s == Currency::COINS[i].name || (Currency::COINS[i].alias != "" && s == Currency::COINS[i].alias)) { value = i; }
+	});
 
 	return value;
 }
@@ -519,13 +1443,16 @@ int VendingMachine::convertStringCoinToInt(std::string s)
 //*************************************************
 //Converts a bill's name to its corresponding index
 //*************************************************
-int VendingMachine::convertStringBillToInt(std::string s)
+template <typename Currency>
+int BasicVendingMachine<Currency>::convertStringBillToInt(std::string_view s)
 {
 	//returns -1 if the string is invalid
 	int value = -1;
 
-	if (s == "1") { value = 0; }
-	else if (s == "5") { value = 1; }
+	//checks the string against the name and other name of each of the currency's bills
+	unroll<AMOUNTOFBILLS>([&](auto i) {
+		if (s == Currency::BILLS[i].name || (Currency::BILLS[i].alias != "" && s == Currency::BILLS[i].alias)) { value = i; }
+	});
 
 	return value;
 }
@@ -533,156 +1460,210 @@ int VendingMachine::convertStringBillToInt(std::string s)
 //*************************************************
 //Converts a cola's name to its corresponding index
 //*************************************************
-int VendingMachine::convertStringColaToInt(std::string s)
+template <typename Currency>
+int BasicVendingMachine<Currency>::convertStringColaToInt(std::string_view s)
 {
 	//returns -1 if the string is invalid
-	int value = -1;
+	return catalog->find(s);
+}
 
-	for (int i = 0; i < SIZEOFCOLATYPES; i++) {
-		if (s == colaTypes[i]) { //checks if the string matches any in the array
-			value = i;
-		}
+//**************************************************************************************************
+//Converts a window such as 30, 6H or 7D to its length in minutes, or -1 if it is not a valid window
+//**************************************************************************************************
+template <typename Currency>
+int BasicVendingMachine<Currency>::convertStringToWindow(std::string_view s)
+{
+	//a window is minutes unless it ends in H for hours or D for days
+	int unit = 1;
+	if (s != "" && (s.back() == 'H' || s.back() == 'D')) {
+		unit = (s.back() == 'H') ? 60 : 24 * 60;
+		s.remove_suffix(1);
 	}
+	else if (s != "" && s.back() == 'M') { s.remove_suffix(1); }
 
-	return value;
+	int amount = 0;
+	std::from_chars_result result = std::from_chars(s.data(), s.data() + s.size(), amount);
+	if (s == "" || result.ec != std::errc() || result.ptr != s.data() + s.size() || amount <= 0 || amount > SalesAnalytics::MAXWINDOW / unit)
+		{ return -1; }
+
+	return amount * unit;
 }
 
 //******************************************************************************
 //Checks if enough change is held in order to dispense change from a transaction
 //******************************************************************************
-bool VendingMachine::checkIfChangeAvailable(double oneOrFiveDollarBill)
+template <typename Currency>
+bool BasicVendingMachine<Currency>::checkIfChangeAvailable(ChangePlan& changePlan)
 {
-
-	bool avaiableChange = false; //holds whether or not change can be made
 	int amountPaid = convertBufferToValue(); //the amount deposited into the machine
 	int desiredChange = amountPaid - PRICE; //the amount change should equal to
+	int values[AMOUNTOFDENOMINATIONS], counts[AMOUNTOFDENOMINATIONS];
+
+	//looks the amount up in the change table, which is only rebuilt after the money held has changed in a way it covers
+	unsigned int version = inventory().changeVersion;
+	getChangeInventory(values, counts);
+	if (version != changeTableVersion) {
+		changeTable.countsChanged(counts);
+		changeTableVersion = version;
+	}
+	changePlan = ChangePlan();
+	changePlan.amount = desiredChange;
 
-	//holds the actual numeric value of the change
-	int changeMade = 0;
+	//works out which bills and coins to pay out so the purchase does not need to again
+	if (changeTable.canMake(desiredChange, values, counts, AMOUNTOFDENOMINATIONS))
+		{ changeTable.plan(desiredChange, changePlan); }
 
-	//temporary variables
-	int fiveBills = bills[1];
-	int oneBills = bills[0];
-	int quarterCoins = coins[2];
-	int dimeCoins = coins[1];
-	int nickelCoins = coins[0];
+	return changePlan.possible;
+}
 
-	//if possible, adds $5 to the temporary value while change needed is more or equal to that
-	while (desiredChange >= (changeMade + 500) && fiveBills > 0) {
-		fiveBills -= 1;
-		changeMade += 500;
-	}
-	//if possible, adds $1 to the temporary value while change needed is more or equal to that
-	while (desiredChange >= (changeMade + 100) && oneBills > 0) {
-		oneBills -= 1;
-		changeMade += 100;
-	}
-	//if possible, adds $0.25 to the temporary value while change needed is more or equal to that
-	while (desiredChange >= (changeMade + 025) && quarterCoins > 0) {
-		quarterCoins -= 1;
-		changeMade += 25;
-	}
-	//if possible, adds $0.10 to the temporary value while change needed is more or equal to that
-	while (desiredChange >= (changeMade + 010) && dimeCoins > 0) {
-		dimeCoins -= 1;
-		changeMade += 10;
-	}
-	//if possible, adds $0.05 to the temporary value while change needed is more or equal to that
-	while (desiredChange >= (changeMade + 005) && nickelCoins > 0) {
-		nickelCoins -= 1;
-		changeMade += 5;
+//************************************************************************************
+//Fills the value and amount held of every bill and coin, from the largest to smallest
+//************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::getChangeInventory(int values[], int counts[])
+{
+	Inventory& held = inventory();
+
+	unroll<AMOUNTOFBILLS>([&](auto i) {
+		values[i] = BILLVALUES[AMOUNTOFBILLS - 1 - i];
+		counts[i] = held.bills[AMOUNTOFBILLS - 1 - i];
+	});
+	unroll<AMOUNTOFCOINS>([&](auto i) {
+		values[AMOUNTOFBILLS + i] = COINVALUES[AMOUNTOFCOINS - 1 - i];
+		counts[AMOUNTOFBILLS + i] = held.coins[AMOUNTOFCOINS - 1 - i];
+	});
+}
+
+//**********************************************************************************************************
+//Takes the planned change out of the inventory, either all of it or none if another session got there first
+//**********************************************************************************************************
+template <typename Currency>
+bool BasicVendingMachine<Currency>::takeChange(const ChangePlan& changePlan)
+{
+	Inventory& held = inventory();
+	std::atomic<int>* counts[AMOUNTOFDENOMINATIONS];
+	unroll<AMOUNTOFBILLS>([&](auto i) { counts[i] = &held.bills[AMOUNTOFBILLS - 1 - i]; });
+	unroll<AMOUNTOFCOINS>([&](auto i) { counts[AMOUNTOFBILLS + i] = &held.coins[AMOUNTOFCOINS - 1 - i]; });
+
+#ifndef NDEBUG
+	//checks that the plan pays out exactly the change it was made for
+	int values[AMOUNTOFDENOMINATIONS], before[AMOUNTOFDENOMINATIONS], planValue = 0;
+	getChangeInventory(values, before);
+	for (int i = 0; i < AMOUNTOFDENOMINATIONS; i++)
+		{ planValue += changePlan.used[i] * values[i]; }
+	assert(planValue == changePlan.amount);
+#endif
+
+	//takes each denomination in turn, putting back what was already taken if one has run short
+	for (int i = 0; i < AMOUNTOFDENOMINATIONS; i++) {
+		if (!Inventory::take(*counts[i], changePlan.used[i])) {
+			for (int j = 0; j < i; j++)
+				{ *counts[j] += changePlan.used[j]; }
+			return false;
+		}
 	}
 
-	if (changeMade == desiredChange) 
-		{ avaiableChange = true; }
+#ifndef NDEBUG
+	//checks that exactly the planned coins and bills came out of each, which can only be seen when no other session shares them
+	int after[AMOUNTOFDENOMINATIONS];
+	getChangeInventory(values, after);
+	for (int i = 0; i < AMOUNTOFDENOMINATIONS; i++)
+		{ assert(sharedInventory != nullptr || before[i] - after[i] == changePlan.used[i]); }
+#endif
 
-	return avaiableChange;
+	if (changePlan.amount > 0) { held.changeVersion++; }
+	return true;
 }
 
-//************************************************
-//Checks if the cola type entered is a valid brand
-//************************************************
-bool VendingMachine::checkForValidCola(std::string s)
+//*******************************************************************
+//Puts change taken for a purchase that did not go through back again
+//*******************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::giveBackChange(const ChangePlan& changePlan)
 {
-	bool validity = false;
-	s = toUpper(s);
+	Inventory& held = inventory();
 
-	//checks the given string against each possible value
-	for (int i = 0; i < SIZEOFCOLATYPES; i++) {
-		if (s == colaTypes[i]) {
-			validity = true;
-		}
+	unroll<AMOUNTOFBILLS>([&](auto i) { held.bills[AMOUNTOFBILLS - 1 - i] += changePlan.used[i]; });
+	unroll<AMOUNTOFCOINS>([&](auto i) { held.coins[AMOUNTOFCOINS - 1 - i] += changePlan.used[AMOUNTOFBILLS + i]; });
+
+	if (changePlan.amount > 0) { held.changeVersion++; }
+}
+
+//************************************************************************************************
+//Plans the change for a purchase and takes it out of the inventory, planning again if it was lost
+//************************************************************************************************
+template <typename Currency>
+bool BasicVendingMachine<Currency>::reserveChange(ChangePlan& changePlan)
+{
+	for (int attempt = 0; attempt < MAXCHANGEATTEMPTS; attempt++) {
+		if (!checkIfChangeAvailable(changePlan)) { return false; }
+		if (takeChange(changePlan)) { return true; }
 	}
 
-	return validity;
+	return false;
+}
+
+//************************************************
+//Checks if the cola type entered is a valid brand
+//************************************************
+template <typename Currency>
+bool BasicVendingMachine<Currency>::checkForValidCola(std::string_view s)
+{
+	//the catalog ignores case, so the string does not need to be upper cased first
+	return catalog->find(s) >= 0;
 }
 
 //**********************************************
 //Checks if the change entered is a valid amount
 //**********************************************
-bool VendingMachine::checkForValidChange(std::string s)
+template <typename Currency>
+bool BasicVendingMachine<Currency>::checkForValidChange(std::string_view s)
 {
-	bool validity = false;
-	const int SIZEOFCHANGETYPES = AMOUNTOFCOINS * 2;
-	std::string changeTypes[] = { "5", "10", "25", "NICKEL", "DIME", "QUARTER"};
-	s = toUpper(s);
-
-	//checks the given string against each possible value
-	for (int i = 0; i < SIZEOFCHANGETYPES; i++) {
-		if (s == changeTypes[i]) {
-			validity = true;
-		}
-	}
+	//compares against each name in any case, so the string is not upper cased into a copy
+	bool valid = false;
+	unroll<AMOUNTOFCOINS>([&](auto i) {
+		valid = valid || Catalog::sameName(s, Currency::COINS[i].name) || (Currency::COINS[i].alias != "" && Catalog::sameName(s, Currency::COINS[i].alias));
+	});
 
-	return validity;
+	return valid;
 }
 
 //********************************************
 //Checks if the bill entered is a valid amount
 //********************************************
-bool VendingMachine::checkForValidBill(std::string s)
+template <typename Currency>
+bool BasicVendingMachine<Currency>::checkForValidBill(std::string_view s)
 {
-	bool validity = false;
-	std::string billTypes[] = { "1", "5" };
-	s = toUpper(s);
+	bool valid = false;
+	unroll<AMOUNTOFBILLS>([&](auto i) {
+		valid = valid || Catalog::sameName(s, Currency::BILLS[i].name) || (Currency::BILLS[i].alias != "" && Catalog::sameName(s, Currency::BILLS[i].alias));
+	});
 
-	//checks the given string against each possible value
-	for (int i = 0; i < AMOUNTOFBILLS; i++) {
-		if (s == billTypes[i]) {
-			validity = true;
-		}
-	}
-
-	return validity;
+	return valid;
 }
 
-//********************************************************
-//Checks if the cola type entered is available to dispense
-//********************************************************
-bool VendingMachine::checkForAvailableCola(std::string s)
+//*****************************************************
+//Checks if the cola chosen is in stock to be dispensed
+//*****************************************************
+template <typename Currency>
+bool BasicVendingMachine<Currency>::checkForAvailableCola(int colaIndex)
 {
-	bool tmp = false;
-	s = toUpper(s);
-	int colaAvailable = cola[convertStringColaToInt(s)];
-
 	//returns true if the number of cola is greater than 0
-	if (colaAvailable > 0)
-		{ tmp = true; }
-
-	return tmp;
+	return inventory().cola[colaIndex] > 0;
 }
 
 //****************************************
 //Converts a string to its numerical value
 //****************************************
-int VendingMachine::convertStringToNumber(std::string s)
+template <typename Currency>
+int BasicVendingMachine<Currency>::convertStringToNumber(std::string_view s)
 {
-	//uses a stringstream for the conversion
-	std::stringstream ss(s);
-
-	//converts the string to the int value
+	//converts the string to the int value without a stringstream, which would allocate
 	int tmp = 0;
-	ss >> tmp;
+	std::from_chars_result result = std::from_chars(s.data(), s.data() + s.size(), tmp);
+
+	//a value too large to hold becomes the largest that can be, as a stringstream would give
+	if (result.ec == std::errc::result_out_of_range) { tmp = INT_MAX; }
 
 	//returns the value
 	return tmp;
@@ -691,7 +1672,8 @@ int VendingMachine::convertStringToNumber(std::string s)
 //**************************************************************************************************************
 //Adds or removes currency of a certain denomination. For example, it may add a single $5 bill to the total held
 //**************************************************************************************************************
-void VendingMachine::addRemoveDenomination(std::string addOrRemove, std::string type, std::string denomination, std::string quantity)
+template <typename Currency>
+void BasicVendingMachine<Currency>::addRemoveDenomination(std::string_view addOrRemove, std::string_view type, std::string_view denomination, std::string_view quantity)
 {
 	int tmpQuantity;
 	int index;
@@ -705,21 +1687,20 @@ void VendingMachine::addRemoveDenomination(std::string addOrRemove, std::string
 
 			//checks if valid denomination is entered
 			if (index >= 0 && index < AMOUNTOFCOINS) {
-				bool quantityOnlyDigits = (quantity.find_first_not_of("0123456789") == std::string::npos); //checks for values that aren't numeric
+				bool quantityOnlyDigits = (quantity.find_first_not_of("0123456789") == std::string_view::npos); //checks for values that aren't numeric
 
 				//adds the item if a valid quantity was requested
 				if (quantityOnlyDigits) {
 					tmpQuantity = convertStringToNumber(quantity);
-					coins[index] += tmpQuantity;
-					std::cout << "Added " << tmpQuantity << " " << denomination << "-denomination " << type << "!\n";
+					addDenomination(index, tmpQuantity, denomination);
 				}
 
 				//displays an error message if an invalid quantity was requested
-				else { std::cout << quantity << " is not a valid quantity" << '\n'; }
+				else { errorStream() << quantity << " is not a valid quantity" << '\n'; }
 			}
 
 			//displays an error message if an invalid denomination was requested
-			else { std::cout << denomination << " is not a valid denomination" << '\n'; }
+			else { errorStream() << denomination << " is not a valid denomination" << '\n'; }
 		}
 
 		//attempts to add a bill
@@ -728,21 +1709,20 @@ void VendingMachine::addRemoveDenomination(std::string addOrRemove, std::string
 
 			//checks if valid denomination is entered
 			if (index >= 0 && index < AMOUNTOFBILLS) {
-				bool quantityOnlyDigits = (quantity.find_first_not_of("0123456789") == std::string::npos); //checks for values that aren't numeric
+				bool quantityOnlyDigits = (quantity.find_first_not_of("0123456789") == std::string_view::npos); //checks for values that aren't numeric
 
 				//adds the item if a valid quantity was requested
 				if (quantityOnlyDigits) {
 					tmpQuantity = convertStringToNumber(quantity);
-					bills[index] += tmpQuantity;
-					std::cout << "Added " << tmpQuantity << " " << denomination << "-denomination " << type << "!\n";
+					addDenomination(AMOUNTOFCOINS + index, tmpQuantity, denomination);
 				}
 
 				//displays an error message if an invalid quantity was requested
-				else { std::cout << quantity << " is not a valid quantity" << '\n'; }
+				else { errorStream() << quantity << " is not a valid quantity" << '\n'; }
 			}
 
 			//displays an error message if an invalid denomination was requested
-			else { std::cout << denomination << " is not a valid denomination" << '\n'; }
+			else { errorStream() << denomination << " is not a valid denomination" << '\n'; }
 		}
 	}
 
@@ -755,25 +1735,20 @@ void VendingMachine::addRemoveDenomination(std::string addOrRemove, std::string
 
 			//checks if valid denomination is entered
 			if (index >= 0 && index < AMOUNTOFCOINS) {
-				bool quantityOnlyDigits = (quantity.find_first_not_of("0123456789") == std::string::npos); //checks for values that aren't numeric
+				bool quantityOnlyDigits = (quantity.find_first_not_of("0123456789") == std::string_view::npos); //checks for values that aren't numeric
 
 				//checks if a valid quantity was requested
 				if (quantityOnlyDigits) {
 					tmpQuantity = convertStringToNumber(quantity);
-
-					//sets the amount of items requested equal to the amount available if more than that was requested
-					if (tmpQuantity > coins[index]) 
-						{ tmpQuantity = coins[index]; }
-					coins[index] -= tmpQuantity;
-					std::cout << "Removed " << tmpQuantity << " " << denomination << "-denomination " << type << ", leaving " << coins[index] << " std::left!\n";
+					removeDenomination(index, tmpQuantity, denomination);
 				}
 
 				//displays an error message if an invalid quantity was requested
-				else { std::cout << quantity << " is not a valid quantity" << '\n'; }
+				else { errorStream() << quantity << " is not a valid quantity" << '\n'; }
 			}
 
 			//displays an error message if an invalid denomination was requested
-			else { std::cout << denomination << " is not a valid denomination" << '\n'; }
+			else { errorStream() << denomination << " is not a valid denomination" << '\n'; }
 		}
 
 		//attempts to remove a bill
@@ -782,263 +1757,440 @@ void VendingMachine::addRemoveDenomination(std::string addOrRemove, std::string
 
 			//checks if valid denomination is entered
 			if (index >= 0 && index < AMOUNTOFBILLS) {
-				bool quantityOnlyDigits = (quantity.find_first_not_of("0123456789") == std::string::npos); //checks for values that aren't numeric
+				bool quantityOnlyDigits = (quantity.find_first_not_of("0123456789") == std::string_view::npos); //checks for values that aren't numeric
 
 				//checks if a valid quantity was requested
 				if (quantityOnlyDigits) {
 					tmpQuantity = convertStringToNumber(quantity);
-
-					//sets the amount of items requested equal to the amount available if more than that was requested
-					if (tmpQuantity > bills[index]) { tmpQuantity = bills[index]; }
-					bills[index] -= tmpQuantity;
-					std::cout << "Removed " << tmpQuantity << " " << denomination << "-denomination " << type << ", leaving " << bills[index] << " std::left!\n";
+					removeDenomination(AMOUNTOFCOINS + index, tmpQuantity, denomination);
 				}
 
 				//displays an error message if an invalid quantity was requested
-				else { std::cout << quantity << " is not a valid quantity" << '\n'; }
+				else { errorStream() << quantity << " is not a valid quantity" << '\n'; }
 			}
 
 			//displays an error message if an invalid denomination was requested
-			else { std::cout << denomination << " is not a valid denomination" << '\n'; }
+			else { errorStream() << denomination << " is not a valid denomination" << '\n'; }
 		}
 	}
 }
 
+//*****************************************************************************************
+//Adds a quantity of the cola in a slot, repeating the brand it was added by, already valid
+//*****************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::addCola(int slot, int quantity, std::string_view brand)
+{
+	inventory().cola[slot] += quantity;
+	logEvent(EVENTRESTOCK, slot, quantity, 0);
+	checkStock(slot);
+	*output << "Added " << quantity << " " << brand << "!\n";
+}
+
+//***********************
+//Adds a quantity of cups
+//***********************
+template <typename Currency>
+void BasicVendingMachine<Currency>::addCups(int quantity)
+{
+	inventory().cups += quantity;
+	logEvent(EVENTRESTOCK, EVENTITEMCUPS, quantity, 0);
+	if (alerts != nullptr) { checkStock(alerts->cupsItem()); }
+	*output << "Added " << quantity << " CUPS!\n";
+}
+
+//****************************************************************************************************
+//Adds a quantity of a coin or bill, numbered with the coins first, repeating the name it was added by
+//****************************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::addDenomination(int denomination, int quantity, std::string_view name)
+{
+	Inventory& held = inventory();
+
+	if (denomination < AMOUNTOFCOINS) {
+		held.coins[denomination] += quantity;
+		logEvent(EVENTMONEY, denomination, quantity, moneyValue(quantity, COINVALUES[denomination]));
+	}
+	else {
+		held.bills[denomination - AMOUNTOFCOINS] += quantity;
+		logEvent(EVENTMONEY, denomination, quantity, moneyValue(quantity, BILLVALUES[denomination - AMOUNTOFCOINS]));
+	}
+	held.changeVersion++;
+	if (alerts != nullptr) { checkStock(alerts->denominationItem(denomination)); }
+	*output << "Added " << quantity << " " << name << "-denomination " << (denomination < AMOUNTOFCOINS ? "COINS" : "BILLS") << "!\n";
+}
+
+//***************************************************************************************************************
+//Removes up to a quantity of a coin or bill, numbered with the coins first, repeating the name it was removed by
+//***************************************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::removeDenomination(int denomination, int quantity, std::string_view name)
+{
+	Inventory& held = inventory();
+	std::atomic<int>& count = (denomination < AMOUNTOFCOINS) ? held.coins[denomination] : held.bills[denomination - AMOUNTOFCOINS];
+	int value = (denomination < AMOUNTOFCOINS) ? COINVALUES[denomination] : BILLVALUES[denomination - AMOUNTOFCOINS];
+
+	//sets the amount of items requested equal to the amount available if more than that was requested
+	quantity = Inventory::takeUpTo(count, quantity);
+	held.changeVersion++;
+	logEvent(EVENTMONEY, denomination, -quantity, -moneyValue(quantity, value));
+	if (alerts != nullptr) { checkStock(alerts->denominationItem(denomination)); }
+	*output << "Removed " << quantity << " " << name << "-denomination " << (denomination < AMOUNTOFCOINS ? "COINS" : "BILLS") << ", leaving " << count << " std::left!\n";
+}
+
 //********************************************************
 //Parses the command out of the string entered by the user
 //********************************************************
-void VendingMachine::parseCommand(std::string linestring)
+template <typename Currency>
+bool BasicVendingMachine<Currency>::parseCommand(std::string_view input)
 {
-	//keeps track of whether or not the command entered is valid
-	bool commandFound = false;
+	commandFailed = false;
+#ifdef VENDING_COUNT_ALLOCATIONS
+	unsigned long long allocationsBefore = heapAllocations.load(std::memory_order_relaxed);
+#endif
 
-	//the amount of possible commands
-	const int NUMOFCOMMANDS = 11;
+	//copies the input into a line the machine keeps, so only a line longer than any before it needs more memory
+	std::string& linestring = commandLine;
+	linestring.assign(input.data(), input.size());
 
-	//list of possible commands
-	std::string validCommands[NUMOFCOMMANDS] = { "UNLOCK", "HELP", "COIN", "BILL", "COLA", "RETURN", "STATUS", "EXIT", "ADD", "REMOVE", "LOCK" };
-
-	std::string command;
-	std::istringstream iss;
-	
-	//adds the user's input into the stream buffer
-	iss.str(linestring); 
-	iss >> command;
-	command = toUpper(command);
+	//splits the user's input once, every later stage works on these tokens
+	CommandTokens tokens;
+	tokens.split(linestring);
+	tokens.toUpper(linestring, 0);
 
-	//checks whether the command is valid
-	for (int i = 0; i < NUMOFCOMMANDS; i++) {
-		if (command == validCommands[i]){
-			if (serviceMode == false && i < 8)
-				commandFound = true;
-
-			else if (serviceMode == true && i > 0)
-				commandFound = true;
-		}
-	}
+	//looks up the command and checks whether it may run in the current mode
+	const CommandRecord<BasicVendingMachine>* record = commandTable<BasicVendingMachine>.find(tokens[0]);
+	int currentMode = serviceMode ? SERVICEMODE : NORMALMODE;
 
 	//displays an error if the command is invalid
-	if (commandFound == false) {
-		std::cout << "Invalid command. Type HELP for a list of valid commands" << '\n';
+	if (record == nullptr || (record->modes & currentMode) == 0) {
+		errorStream() << "Invalid command. Type HELP for a list of valid commands" << '\n';
 	}
 
 	//parses the option if the command is valid
 	else {
-		parseOption(command, linestring);
+		parseOption(*record, tokens, linestring);
 	}
+
+#ifdef VENDING_COUNT_ALLOCATIONS
+	//counts what the command allocated, which is 0 for every command once the machine has warmed up
+	commandAllocations += heapAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+	commandsCounted++;
+#endif
+
+	//returns whether the command ran without reporting an error
+	return !commandFailed;
 }
 
-//*******************************************************
-//Parses the option out of the string entered by the user
-//*******************************************************
-void VendingMachine::parseOption(std::string command, std::string linestring)
+//*****************************************************************************************************************
+//Runs a command that was already parsed and validated, timed under its place in the command records like any other
+//*****************************************************************************************************************
+template <typename Currency>
+template <typename Operation>
+bool BasicVendingMachine<Currency>::runCommand(int command, Operation&& operation)
 {
-	std::string tmpString, option = "";
-	std::istringstream iss;
+	commandFailed = false;
+#ifdef VENDING_COUNT_ALLOCATIONS
+	unsigned long long allocationsBefore = heapAllocations.load(std::memory_order_relaxed);
+#endif
+
+	timeCommand(command, operation);
 
-	//adds the user's input back into the stream buffer
-	iss.str(linestring);
+#ifdef VENDING_COUNT_ALLOCATIONS
+	commandAllocations += heapAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+	commandsCounted++;
+#endif
 
-	//removes the command from the buffer
-	iss >> tmpString;
+	return !commandFailed;
+}
 
-	//gets the command
-	if (iss) {
-		iss >> option;
+//********************************************************************************************************************
+//Runs a command, timing it with the cycle counter under its place in the command records if the machine records times
+//********************************************************************************************************************
+template <typename Currency>
+template <typename Operation>
+void BasicVendingMachine<Currency>::timeCommand([[maybe_unused]] int command, Operation&& operation)
+{
+#if VENDING_METRICS
+	if (metrics != nullptr) {
+		std::uint64_t start = readCycleCounter();
+		operation();
+		metrics->latency[command].record(readCycleCounter() - start);
 	}
+	else { operation(); }
+#else
+	operation();
+#endif
+}
 
-	//toUpper's the option unless the command was lock or unlock
-	if (command != "LOCK" && command != "UNLOCK") {
-		option = toUpper(option);
+//*******************************************************
+//Parses the option out of the string entered by the user
+//*******************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::parseOption(const CommandRecord<BasicVendingMachine>& record, CommandTokens& tokens, std::string& linestring)
+{
+	//toUpper's the option unless the command needs it as typed (such as a password)
+	if (!record.keepOptionCase) {
+		tokens.toUpper(linestring, 1);
 	}
 
 	//parses the switch
-	parseSwitch(option, command, linestring);
+	parseSwitch(record, tokens, linestring);
 }
 
 //*******************************************************
 //Parses the switch out of the string entered by the user
 //*******************************************************
-void VendingMachine::parseSwitch(std::string option, std::string command, std::string linestring)
+template <typename Currency>
+void BasicVendingMachine<Currency>::parseSwitch(const CommandRecord<BasicVendingMachine>& record, CommandTokens& tokens, std::string& linestring)
 {
-	const int NUMOFSWITCHES = 2;
-	std::string switchParameter[NUMOFSWITCHES] = { "", "" };
-	std::istringstream iss;
-
-	//used to check if the command has too many parameters
-	std::string tmpSwitch;
-
-	//adds the user's input back into the stream buffer
-	iss.str(linestring);
-
-	//removes the command and option from the buffer
-	for (int i = 0; i < 2; i++) {
-		iss >> tmpSwitch;
-	}
-
-	//gets the next two parameters
-	for (int i = 0; i < 2; i++) {
-		if (iss) {
-			iss >> switchParameter[i];
-		}
-	}
-
-	//checks and gets if there are any last aditional parameters
-	tmpSwitch = "";
-	if (iss) {
-		iss >> tmpSwitch;
-	}
-
-	switchParameter[0] = toUpper(switchParameter[0]);
-	switchParameter[1] = toUpper(switchParameter[1]);
+	tokens.toUpper(linestring, 2);
+	tokens.toUpper(linestring, 3);
 
 	//parses the full command if there are not too many parameters
-	if (tmpSwitch != "") 
-		{ std::cout << "Too many parameters!" << '\n'; }
+	if (tokens.count == CommandTokens::MAXTOKENS) 
+		{ errorStream() << "Too many parameters!" << '\n'; }
 	else
-		{ goToCmd(command, option, switchParameter[0], switchParameter[1]); }
+		{ goToCmd(record, tokens); }
 	
 }
 
 //**************************************************************************************************
 //Takes the individually parsed input and parses the full command to call the corresponding function
 //**************************************************************************************************
-void VendingMachine::goToCmd(std::string command, std::string option, std::string switchParameter, std::string switchParameter2)
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToCmd(const CommandRecord<BasicVendingMachine>& record, const CommandTokens& tokens)
 {
-	//runs the requested exit command if the correct amount of parameters were given
-	if (command == "EXIT") {
-		if (option == "") { runProgram = false; }
-		else { std::cout << "The " << option << " option is not valid for the " << command << " command" << '\n'; }
-	}
+	std::string_view command = tokens[0];
+	int parameters = tokens.count - 1;
 
-	//runs the requested help command if the correct amount of parameters were given
-	else if (command == "HELP") {
-		if (option == "") { helpCmd(); }
-		else { std::cout << "The " << option << " option is not valid for the " << command << " command" << '\n'; }
+	//displays an error message that the requested command had too few parameters
+	if (parameters < record.minParameters) {
+		errorStream() << "The " << command << " command has too few parameters " << '\n';
 	}
 
-	//runs the requested return command if the correct amount of parameters were given
-	else if (command == "RETURN") {
-		if (option == "") { returnCmd(); }
-		else { std::cout << "The " << option << " option is not valid for the " << command << " command" << '\n'; }
+	//displays an error message for the first parameter the command does not accept
+	else if (parameters > record.maxParameters) {
+		if (record.maxParameters == 0)
+			{ errorStream() << "The " << tokens[1] << " option is not valid for the " << command << " command" << '\n'; }
+		else if (record.maxParameters == 1)
+			{ errorStream() << "A switch parameter is not valid for the " << command << " command" << '\n'; }
+		else
+			{ errorStream() << "The " << command << " command has too many parameters" << '\n'; }
 	}
 
-	//runs the requested lock command if the correct amount of parameters were given
-	else if (command == "LOCK" && option != "") {
-		if (switchParameter == "") { lockCmd(option); }
-		else { std::cout << "A switch parameter is not valid for the " << command << " command" << '\n'; }
+	//runs the requested command if the correct amount of parameters were given, timed the same way as a compiled command
+	else {
+		int place = static_cast<int>(&record - commandRecords<BasicVendingMachine>);
+		timeCommand(place, [&]() { (this->*record.handler)(tokens); });
 	}
+}
 
-	//runs the requested unlock command if the correct amount of parameters were given
-	else if (command == "UNLOCK" && option != "") {
-		if (switchParameter == "") { unlockCmd(option); }
-		else { std::cout << "A switch parameter is not valid for the " << command << " command" << '\n'; }
-	}
+//*****************************************
+//Runs the exit command from a parsed input
+//*****************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToExitCmd(const CommandTokens&)
+{
+	runProgram = false;
+}
 
-	//runs the requested status command if the correct amount of parameters were given
-	else if (command == "STATUS") {
-		if (option == "") { statusCmd(); }
-		else { std::cout << "The " << option << " option is not valid for the " << command << " command" << '\n'; }
-	}
+//*****************************************
+//Runs the help command from a parsed input
+//*****************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToHelpCmd(const CommandTokens&)
+{
+	helpCmd();
+}
 
-	//runs the requested coin command if the correct amount of parameters were given
-	else if (command == "COIN" && option != "") {
-		if (switchParameter == "") { coinCmd(option); }
-		else { std::cout << "A switch parameter is not valid for the " << command << " command" << '\n'; }
-	}
+//*******************************************
+//Runs the return command from a parsed input
+//*******************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToReturnCmd(const CommandTokens&)
+{
+	returnCmd();
+}
 
-	//runs the requested bill command if the correct amount of parameters were given
-	else if (command == "BILL" && option != "") {
-		if (switchParameter == "") { billCmd(option); }
-		else { std::cout << "A switch parameter is not valid for the " << command << " command" << '\n'; }
-	}
+//*****************************************
+//Runs the lock command from a parsed input
+//*****************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToLockCmd(const CommandTokens& tokens)
+{
+	lockCmd(tokens[1]);
+}
 
-	//runs the requested cola command if the correct amount of parameters were given
-	else if (command == "COLA" && option != "") {
-		if (switchParameter2 == "") { colaCmd(option, switchParameter); }
-		else { std::cout << "The " << command << " command has too many parameters" << '\n'; }
-	}
+//*******************************************
+//Runs the unlock command from a parsed input
+//*******************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToUnlockCmd(const CommandTokens& tokens)
+{
+	unlockCmd(tokens[1]);
+}
 
-	//runs the requested add or remove command if the correct amount of parameters were given
-	else if (command == "ADD" && option != "" || command == "REMOVE" && option != "") {
+//*******************************************
+//Runs the status command from a parsed input
+//*******************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToStatusCmd(const CommandTokens&)
+{
+	statusCmd();
+}
 
-		//checks if an appropriate number of parameters are given if the user want to add/remove cups
-		if (option == "CUPS" && command == "ADD") {
-			if (switchParameter != "") {
-				if (switchParameter2 == "") {
-					adjustItemCountCmd(command, option, switchParameter, switchParameter2);
-				}
+//*****************************************
+//Runs the coin command from a parsed input
+//*****************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToCoinCmd(const CommandTokens& tokens)
+{
+	coinCmd(tokens[1]);
+}
 
-				//displays an error message that the command has too many parameters
-				else { std::cout << "The " << command << " command has too many parameters" << '\n'; }
-			}
+//*****************************************
+//Runs the bill command from a parsed input
+//*****************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToBillCmd(const CommandTokens& tokens)
+{
+	billCmd(tokens[1]);
+}
 
-			//displays an error message that the command has too few parameters
-			else { std::cout << "The " << command << " command has too few parameters" << '\n'; }
-		}
+//*****************************************
+//Runs the cola command from a parsed input
+//*****************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToColaCmd(const CommandTokens& tokens)
+{
+	colaCmd(tokens[1], tokens[2]);
+}
+
+//**************************************************
+//Runs the add or remove command from a parsed input
+//**************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToAddRemoveCmd(const CommandTokens& tokens)
+{
+	std::string_view command = tokens[0], option = tokens[1], switchParameter = tokens[2], switchParameter2 = tokens[3];
 
-		//checks if an appropriate number of parameters are given if the user want to add/remove cola
-		else if (option == "COLA" && command == "ADD") {
-			if (switchParameter2 != "") {
+	//checks if an appropriate number of parameters are given if the user want to add/remove cups
+	if (option == "CUPS" && command == "ADD") {
+		if (switchParameter != "") {
+			if (switchParameter2 == "") {
 				adjustItemCountCmd(command, option, switchParameter, switchParameter2);
 			}
 
-			//displays an error message that the command has too few parameters
-			else { std::cout << "The " << command << " command has too few parameters" << '\n'; }
+			//displays an error message that the command has too many parameters
+			else { errorStream() << "The " << command << " command has too many parameters" << '\n'; }
 		}
 
-		//checks if an appropriate number of parameters are given if the user want to add/remove coins
-		else if (option == "COINS") {
-			if (switchParameter2 != "") {
-				addRemoveDenomination(command, option, switchParameter, switchParameter2);
-			}
+		//displays an error message that the command has too few parameters
+		else { errorStream() << "The " << command << " command has too few parameters" << '\n'; }
+	}
 
-			//displays an error message that the command has too few parameters
-			else { std::cout << "The " << command << " command has too few parameters" << '\n'; }
+	//checks if an appropriate number of parameters are given if the user want to add/remove cola
+	else if (option == "COLA" && command == "ADD") {
+		if (switchParameter2 != "") {
+			adjustItemCountCmd(command, option, switchParameter, switchParameter2);
 		}
 
-		//checks if an appropriate number of parameters are given if the user want to add/remove bills
-		else if (option == "BILLS") {
-			if (switchParameter2 != "") {
-				addRemoveDenomination(command, option, switchParameter, switchParameter2);
-			}
+		//displays an error message that the command has too few parameters
+		else { errorStream() << "The " << command << " command has too few parameters" << '\n'; }
+	}
 
-			//displays an error message that the command has too few parameters
-			else { std::cout << "The " << command << " command has too few parameters " << '\n'; }
+	//checks if an appropriate number of parameters are given if the user want to add/remove coins
+	else if (option == "COINS") {
+		if (switchParameter2 != "") {
+			addRemoveDenomination(command, option, switchParameter, switchParameter2);
 		}
 
-		//displays an error message that the option is invalid
-		else { std::cout << "The " << option << " option is not valid for the " << command << " command" << '\n'; }
+		//displays an error message that the command has too few parameters
+		else { errorStream() << "The " << command << " command has too few parameters" << '\n'; }
 	}
 
-	//displays an error message that the requested command had too few parameters
-	else { std::cout << "The " << command << " command has too few parameters " << '\n'; }
+	//checks if an appropriate number of parameters are given if the user want to add/remove bills
+	else if (option == "BILLS") {
+		if (switchParameter2 != "") {
+			addRemoveDenomination(command, option, switchParameter, switchParameter2);
+		}
+
+		//displays an error message that the command has too few parameters
+		else { errorStream() << "The " << command << " command has too few parameters " << '\n'; }
+	}
+
+	//displays an error message that the option is invalid
+	else { errorStream() << "The " << option << " option is not valid for the " << command << " command" << '\n'; }
+}
+
+//*******************************************
+//Runs the allocs command from a parsed input
+//*******************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToAllocsCmd(const CommandTokens&)
+{
+	allocsCmd();
+}
+
+//********************************************
+//Runs the metrics command from a parsed input
+//********************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToMetricsCmd(const CommandTokens& tokens)
+{
+	std::string_view option = tokens[1];
+
+	//shows the metrics, or resets them if asked to
+	if (option == "" || option == "RESET")
+		{ metricsCmd(option == "RESET"); }
+	else
+		{ errorStream() << "The " << option << " option is not valid for the " << tokens[0] << " command" << '\n'; }
+}
+
+//************************************************************************************
+//Runs the sales command from a parsed input, over the last hour unless given a window
+//************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToSalesCmd(const CommandTokens& tokens)
+{
+	std::string_view option = tokens[1];
+	int minutes = (option == "") ? 60 : convertStringToWindow(option);
+
+	if (minutes > 0)
+		{ salesCmd(minutes); }
+	else
+		{ errorStream() << option << " is not a valid window for the " << tokens[0] << " command, such as 30, 6h or 7d up to 30d" << '\n'; }
+}
+
+//**********************************************************************************************
+//Runs the alerts command from a parsed input, listing low items unless given a threshold to set
+//**********************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToAlertsCmd(const CommandTokens& tokens)
+{
+	if (tokens[1] == "")
+		{ alertsCmd(); }
+	else if (tokens[2] != "")
+		{ thresholdCmd(tokens[1], tokens[2], tokens[3]); }
+	else
+		{ errorStream() << "The " << tokens[0] << " command has too few parameters" << '\n'; }
+}
+
+//*************************************************************************
+//Runs the restock command from a parsed input, with the file name as typed
+//*************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::goToRestockCmd(const CommandTokens& tokens)
+{
+	restockCmd(tokens[1]);
 }
 
 //**********************************************************************
 //Returns the value of runProgram to determine if the program is exiting
 //**********************************************************************
-bool VendingMachine::getProgramRunningStatus() {
+template <typename Currency>
+bool BasicVendingMachine<Currency>::getProgramRunningStatus() {
 	return runProgram;
 }
 
@@ -1046,18 +2198,245 @@ bool VendingMachine::getProgramRunningStatus() {
 //*************************************************************************
 //Returns the value of serviceMode to determine what mode the program is in
 //*************************************************************************
-bool VendingMachine::getModeStatus() {
+template <typename Currency>
+bool BasicVendingMachine<Currency>::getModeStatus() {
 	return serviceMode;
 }
 
+//***********************************************************************
+//Returns the inventory the machine sells from, which may be a shared one
+//***********************************************************************
+template <typename Currency>
+typename BasicVendingMachine<Currency>::Inventory& BasicVendingMachine<Currency>::inventory() {
+	return sharedInventory != nullptr ? *sharedInventory : ownInventory;
+}
+
+//************************************************************************************************
+//Returns the deposit the command being run spends from, which is the customer's while serving one
+//************************************************************************************************
+template <typename Currency>
+typename BasicVendingMachine<Currency>::Deposit& BasicVendingMachine<Currency>::deposit() {
+	return customerDeposit != nullptr ? *customerDeposit : ownDeposit;
+}
+
+//*******************************************************************
+//Returns how the purchases attempted on this machine have turned out
+//*******************************************************************
+template <typename Currency>
+const PurchaseStatistics& BasicVendingMachine<Currency>::getStatistics() {
+	return statistics;
+}
+
+//*******************************************************************
+//Copies everything the machine needs to be brought back into a state
+//*******************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::getState(State& state)
+{
+	Inventory& held = inventory();
+	const Deposit& paid = deposit();
+	state.passwordHash = passwordHash;
+	state.catalogFingerprint = catalog->fingerprint();
+
+	for (int i = 0; i < AMOUNTOFCOINS; i++) {
+		state.coins[i] = held.coins[i];
+		state.coinsBuffer[i] = paid.coinsBuffer[i];
+	}
+	for (int i = 0; i < AMOUNTOFBILLS; i++) {
+		state.bills[i] = held.bills[i];
+		state.billsBuffer[i] = paid.billsBuffer[i];
+	}
+	state.cola.resize(held.amountOfCola);
+	for (int i = 0; i < held.amountOfCola; i++)
+		{ state.cola[i] = held.cola[i]; }
+	state.cups = held.cups;
+	state.serviceMode = serviceMode;
+}
+
 //********************************************
-//Converts a string to soley upper case values
+//Brings the machine back to a state it was in
 //********************************************
-std::string VendingMachine::toUpper(std::string s)
+template <typename Currency>
+bool BasicVendingMachine<Currency>::setState(const State& state)
+{
+	Inventory& held = inventory();
+	Deposit& paid = deposit();
+
+	//a state can only be brought back into a machine selling the same products
+	if (state.catalogFingerprint != catalog->fingerprint() || static_cast<int>(state.cola.size()) != held.amountOfCola)
+		{ return false; }
+	passwordHash = state.passwordHash;
+
+	for (int i = 0; i < AMOUNTOFCOINS; i++) {
+		held.coins[i] = state.coins[i];
+		paid.coinsBuffer[i] = state.coinsBuffer[i];
+	}
+	for (int i = 0; i < AMOUNTOFBILLS; i++) {
+		held.bills[i] = state.bills[i];
+		paid.billsBuffer[i] = state.billsBuffer[i];
+	}
+	for (int i = 0; i < held.amountOfCola; i++)
+		{ held.cola[i] = state.cola[i]; }
+	held.cups = state.cups;
+	serviceMode = state.serviceMode != 0;
+
+	//the deposit total and the change table follow from what was restored
+	paid.bufferValue = 0;
+	for (int i = 0; i < AMOUNTOFCOINS; i++) { paid.bufferValue += paid.coinsBuffer[i] * COINVALUES[i]; }
+	for (int i = 0; i < AMOUNTOFBILLS; i++) { paid.bufferValue += paid.billsBuffer[i] * BILLVALUES[i]; }
+	held.changeVersion++;
+	checkAllStock();
+
+	return true;
+}
+
+//*************************************************
+//Checks if two states hold exactly the same values
+//*************************************************
+template <typename Currency>
+bool BasicVendingMachine<Currency>::State::operator==(const State& other) const
+{
+	return passwordHash == other.passwordHash && catalogFingerprint == other.catalogFingerprint
+		&& std::equal(coins, coins + AMOUNTOFCOINS, other.coins) && std::equal(bills, bills + AMOUNTOFBILLS, other.bills)
+		&& cups == other.cups && std::equal(coinsBuffer, coinsBuffer + AMOUNTOFCOINS, other.coinsBuffer)
+		&& std::equal(billsBuffer, billsBuffer + AMOUNTOFBILLS, other.billsBuffer) && serviceMode == other.serviceMode
+		&& cola == other.cola;
+}
+
+//*************************************************************************************
+//Sells the products of the given catalog, making room for their stock in the inventory
+//*************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::setCatalog(const Catalog& products)
+{
+	catalog = &products;
+
+	//a shared inventory must be given its products before any kiosk starts selling from it
+	if (inventory().amountOfCola != products.size())
+		{ inventory().setProducts(products.size()); }
+}
+
+//**************************************
+//Returns the products the machine sells
+//**************************************
+template <typename Currency>
+const Catalog& BasicVendingMachine<Currency>::getCatalog()
+{
+	return *catalog;
+}
+
+//******************************************************************
+//Records every later change to the stock and money in the given log
+//******************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::setEventLog(EventLog* log)
+{
+	eventLog = log;
+}
+
+//************************************************************************************
+//Records how long every later command takes in the given metrics, or stops if nullptr
+//************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::setMetrics([[maybe_unused]] CommandMetrics* commandMetrics)
+{
+#if VENDING_METRICS
+	metrics = commandMetrics;
+#endif
+}
+
+//*******************************************************************************
+//Counts every later sale and deposit in the given analytics, or stops if nullptr
+//*******************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::setAnalytics(SalesAnalytics* salesAnalytics)
+{
+	analytics = salesAnalytics;
+}
+
+//**************************************************************************************************************
+//Watches every item for running low in the given alerts, starting from the counts held now, or stops if nullptr
+//**************************************************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::setAlerts(StockAlerts* stockAlerts)
+{
+	alerts = stockAlerts;
+	checkAllStock();
+}
+
+//****************************************************************************
+//Tells the alerts how many of an item are held now, if the machine has alerts
+//****************************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::checkStock(int item)
+{
+	if (alerts == nullptr) { return; }
+	Inventory& held = inventory();
+
+	//items are numbered with the products first, then the cups, then the coins and then the bills
+	int count;
+	if (item < alerts->cupsItem()) { count = (item < held.amountOfCola) ? held.cola[item].load() : 0; }
+	else if (item == alerts->cupsItem()) { count = held.cups; }
+	else {
+		int denomination = item - alerts->denominationItem(0);
+		count = (denomination < AMOUNTOFCOINS) ? held.coins[denomination] : held.bills[denomination - AMOUNTOFCOINS];
+	}
+
+	alerts->update(item, count);
+}
+
+//*******************************************************************
+//Tells the alerts how many of every item are held now, if it has any
+//*******************************************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::checkAllStock()
+{
+	if (alerts == nullptr) { return; }
+
+	for (int item = 0; item < alerts->size(); item++)
+		{ checkStock(item); }
+}
+
+//*****************************************
+//Records an event if the machine has a log
+//*****************************************
+template <typename Currency>
+void BasicVendingMachine<Currency>::logEvent(int type, int item, int quantity, int cents)
+{
+	if (eventLog != nullptr)
+		{ eventLog->append(type, item, quantity, cents); }
+}
+
+//******************************************************************************************************
+//Returns the value in cents of a quantity of a coin or bill, held to the most an event record can store
+//******************************************************************************************************
+template <typename Currency>
+int BasicVendingMachine<Currency>::moneyValue(int quantity, int value)
+{
+	//multiplies in long long, as adding a large quantity of a large bill is past what an int holds
+	long long cents = static_cast<long long>(quantity) * value;
+	return static_cast<int>(std::clamp<long long>(cents, -INT_MAX, INT_MAX));
+}
+
+//************************************************************************************
+//Marks the current command as failed and returns the stream its error is displayed on
+//************************************************************************************
+template <typename Currency>
+std::ostream& BasicVendingMachine<Currency>::errorStream()
+{
+	commandFailed = true;
+	return *output;
+}
+
+//*****************************************************
+//Converts a string to soley upper case values in place
+//*****************************************************
+template <typename Currency>
+std::string& BasicVendingMachine<Currency>::toUpper(std::string& s)
 {
 	//loops through the string to convert each character to uppercase
 	for (auto& c : s)
-		{ c = toupper(c); } 
+		{ c = static_cast<char>(toupper(static_cast<unsigned char>(c))); } 
 
 	return s;
 }
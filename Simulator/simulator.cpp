@@ -0,0 +1,345 @@
+// simulator.cpp - Antonio Mastroianni
+// Runs a fleet of simulated vending machines across every core to load test change float and stock policies before they are deployed
+
+//NOTE: Builds on Linux with   g++ -std=c++17 -O2 -pthread -I../Project1 simulator.cpp -o simulator
+//      Per machine results are written as CSV to the file given with --csv
+//      --contention K runs K kiosks on their own threads against one shared inventory and exits with 1 if it ends up inconsistent
+
+#include "vending.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//discards everything a simulated machine displays
+class NullBuffer : public std::streambuf
+{
+protected:
+	int overflow(int c) override { return c; }
+	std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+//the stocking and traffic policy every machine in the fleet is run with
+struct Policy
+{
+	int commandsPerMachine = 10000;
+	int colaStock = 20; //the amount of each cola loaded at the start and on each restock
+	int cupStock = 100;
+	int coinFloat = 20; //the amount of each coin loaded at the start and on each restock
+	int restockEvery = 2000; //the amount of commands between restocks
+};
+
+//a machine together with its own output stream so that no two machines share any state
+struct SimulatedMachine
+{
+	NullBuffer buffer;
+	std::ostream output{ &buffer };
+	VendingMachine machine{ output };
+	long long commandsRun = 0;
+};
+
+//*********************************************************************
+//Generates the next pseudo random number of a machine's command stream
+//*********************************************************************
+std::uint64_t nextRandom(std::uint64_t& state)
+{
+	//splitmix64, which is fast and gives every machine an independent stream from its seed
+	std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+//***************************************************************
+//Loads a machine with the policy's stock of cola, cups and coins
+//***************************************************************
+void restock(VendingMachine& machine, const Policy& policy, std::string& line)
+{
+	const char* colas[] = { "COKE", "PEPSI", "SPRITE", "FANTA", "FAYGO" };
+	const char* coins[] = { "NICKEL", "DIME", "QUARTER" };
+
+	for (const char* cola : colas) {
+		line.assign("ADD COLA ").append(cola).append(" ").append(std::to_string(policy.colaStock));
+		machine.parseCommand(line);
+	}
+	for (const char* coin : coins) {
+		line.assign("ADD COINS ").append(coin).append(" ").append(std::to_string(policy.coinFloat));
+		machine.parseCommand(line);
+	}
+	line.assign("ADD CUPS ").append(std::to_string(policy.cupStock));
+	machine.parseCommand(line);
+}
+
+//**********************************************************************
+//Runs a machine through its whole synthetic stream of customer commands
+//**********************************************************************
+void simulateMachine(SimulatedMachine& simulated, std::uint64_t seed, const Policy& policy)
+{
+	const char* deposits[] = { "COIN NICKEL", "COIN DIME", "COIN QUARTER", "COIN QUARTER", "BILL 1", "BILL 1", "BILL 5" };
+	const char* purchases[] = { "COLA COKE", "COLA PEPSI", "COLA SPRITE", "COLA FANTA", "COLA FAYGO -NO_ICE" };
+	const int AMOUNTOFDEPOSITS = sizeof(deposits) / sizeof(deposits[0]);
+	const int AMOUNTOFPURCHASES = sizeof(purchases) / sizeof(purchases[0]);
+
+	VendingMachine& machine = simulated.machine;
+	std::uint64_t state = seed;
+	std::string line;
+	line.reserve(64);
+
+	restock(machine, policy, line);
+
+	for (int i = 1; i <= policy.commandsPerMachine; i++) {
+		std::uint64_t roll = nextRandom(state) % 100;
+
+		//restocks periodically, otherwise customers mostly deposit money and sometimes buy or give up
+		if (i % policy.restockEvery == 0) { restock(machine, policy, line); }
+		else if (roll < 60) { line.assign(deposits[nextRandom(state) % AMOUNTOFDEPOSITS]); machine.parseCommand(line); }
+		else if (roll < 95) { line.assign(purchases[nextRandom(state) % AMOUNTOFPURCHASES]); machine.parseCommand(line); }
+		else { line.assign("RETURN"); machine.parseCommand(line); }
+	}
+
+	simulated.commandsRun = policy.commandsPerMachine;
+}
+
+//***************************************************************************************************
+//Runs several kiosks against one shared inventory at once and checks that no stock or money was lost
+//***************************************************************************************************
+bool runContentionTest(int kiosks, std::uint64_t seed, const Policy& policy)
+{
+	const char* deposits[] = { "COIN NICKEL", "COIN DIME", "COIN QUARTER", "COIN QUARTER", "BILL 1", "BILL 1", "BILL 5" };
+	const char* purchases[] = { "COLA COKE", "COLA PEPSI", "COLA SPRITE", "COLA FANTA", "COLA FAYGO -NO_ICE" };
+	const int AMOUNTOFDEPOSITS = sizeof(deposits) / sizeof(deposits[0]);
+	const int AMOUNTOFPURCHASES = sizeof(purchases) / sizeof(purchases[0]);
+	const int PRICE = 145;
+
+	//stocks the shared inventory once, kiosks never restock so every sale must come out of this stock
+	VendingMachine::Inventory shared;
+	for (int i = 0; i < shared.amountOfCola; i++) { shared.cola[i] = policy.colaStock; }
+	for (auto& count : shared.coins) { count = policy.coinFloat; }
+	shared.cups = policy.cupStock;
+	long long initialValue = shared.heldValue();
+
+	std::unique_ptr<NullBuffer[]> buffers(new NullBuffer[kiosks]);
+	std::vector<std::unique_ptr<std::ostream>> outputs;
+	std::vector<std::unique_ptr<VendingMachine>> machines;
+	for (int i = 0; i < kiosks; i++) {
+		outputs.push_back(std::make_unique<std::ostream>(&buffers[i]));
+		machines.push_back(std::make_unique<VendingMachine>(shared, *outputs[i]));
+	}
+
+	//every kiosk runs its own customers on its own thread, all of them buying from the same stock
+	std::vector<std::thread> running;
+	for (int i = 0; i < kiosks; i++) {
+		running.emplace_back([&, i]() {
+			VendingMachine& machine = *machines[i];
+			std::uint64_t state = seed * 1000003ull + static_cast<std::uint64_t>(i);
+			std::string line;
+			line.reserve(64);
+
+			for (int c = 0; c < policy.commandsPerMachine; c++) {
+				std::uint64_t roll = nextRandom(state) % 100;
+				if (roll < 60) { line.assign(deposits[nextRandom(state) % AMOUNTOFDEPOSITS]); }
+				else if (roll < 95) { line.assign(purchases[nextRandom(state) % AMOUNTOFPURCHASES]); }
+				else { line.assign("RETURN"); }
+				machine.parseCommand(line);
+			}
+
+			//hands back anything left deposited so every cent is either sold or returned
+			line.assign("RETURN");
+			machine.parseCommand(line);
+		});
+	}
+	for (std::thread& thread : running)
+		{ thread.join(); }
+
+	long long sales = 0;
+	for (int i = 0; i < kiosks; i++)
+		{ sales += machines[i]->getStatistics().sales; }
+
+	//checks that every count stayed in range and that stock and money add up to what was sold
+	bool consistent = true;
+	long long colaLeft = 0;
+	for (int i = 0; i < shared.amountOfCola; i++) { colaLeft += shared.cola[i]; consistent = consistent && shared.cola[i] >= 0; }
+	for (auto& count : shared.coins) { consistent = consistent && count >= 0; }
+	for (auto& count : shared.bills) { consistent = consistent && count >= 0; }
+	consistent = consistent && shared.cups >= 0;
+
+	bool colaAddsUp = sales + colaLeft == static_cast<long long>(policy.colaStock) * shared.amountOfCola;
+	bool cupsAddUp = sales + shared.cups == policy.cupStock;
+	bool moneyAddsUp = shared.heldValue() == initialValue + sales * PRICE;
+
+	std::cout << "Kiosks:        " << kiosks << " sharing one inventory\n";
+	std::cout << "Sales:         " << sales << '\n';
+	std::cout << "Counts >= 0:   " << (consistent ? "yes" : "NO") << '\n';
+	std::cout << "Cola adds up:  " << (colaAddsUp ? "yes" : "NO") << " (" << colaLeft << " left)\n";
+	std::cout << "Cups add up:   " << (cupsAddUp ? "yes" : "NO") << " (" << shared.cups << " left)\n";
+	std::cout << "Money adds up: " << (moneyAddsUp ? "yes" : "NO") << " (" << shared.heldValue() << " cents held)\n";
+
+	return consistent && colaAddsUp && cupsAddUp && moneyAddsUp;
+}
+
+//runs tasks on a fixed set of threads, where a thread that runs out of its own tasks steals from the others
+class WorkStealingPool
+{
+private:
+
+	//a deque of task indexes, the owner takes from the back and thieves from the front
+	struct Worker
+	{
+		std::mutex lock;
+		std::deque<int> tasks;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+
+	//takes the next task from the worker's own deque, or steals one from another worker
+	bool nextTask(int self, int& task)
+	{
+		{
+			std::lock_guard<std::mutex> guard(workers[self]->lock);
+			if (!workers[self]->tasks.empty()) {
+				task = workers[self]->tasks.back();
+				workers[self]->tasks.pop_back();
+				return true;
+			}
+		}
+
+		for (std::size_t offset = 1; offset < workers.size(); offset++) {
+			Worker& victim = *workers[(self + offset) % workers.size()];
+			std::lock_guard<std::mutex> guard(victim.lock);
+			if (!victim.tasks.empty()) {
+				task = victim.tasks.front();
+				victim.tasks.pop_front();
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+public:
+
+	explicit WorkStealingPool(int threads)
+	{
+		for (int i = 0; i < threads; i++)
+			{ workers.push_back(std::make_unique<Worker>()); }
+	}
+
+	//deals the tasks out to the workers in contiguous shards and runs them all to completion
+	template <typename Function>
+	void run(int amountOfTasks, Function runTask)
+	{
+		int threads = static_cast<int>(workers.size());
+		for (int i = 0; i < amountOfTasks; i++)
+			{ workers[static_cast<long long>(i) * threads / amountOfTasks]->tasks.push_back(i); }
+
+		std::vector<std::thread> running;
+		for (int self = 0; self < threads; self++) {
+			running.emplace_back([this, self, &runTask]() {
+				int task;
+				while (nextTask(self, task))
+					{ runTask(task); }
+			});
+		}
+
+		for (std::thread& thread : running)
+			{ thread.join(); }
+	}
+};
+
+//*************
+//Main Function
+//*************
+int main(int argc, char* argv[])
+{
+	int amountOfMachines = 1000;
+	int threads = static_cast<int>(std::thread::hardware_concurrency());
+	std::uint64_t seed = 1;
+	std::string csvName;
+	int kiosks = 0; //when set, runs the shared inventory contention test instead of the fleet
+	Policy policy;
+
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (argument == "--machines" && hasValue) { amountOfMachines = std::atoi(argv[++i]); }
+		else if (argument == "--threads" && hasValue) { threads = std::atoi(argv[++i]); }
+		else if (argument == "--commands" && hasValue) { policy.commandsPerMachine = std::atoi(argv[++i]); }
+		else if (argument == "--cola-stock" && hasValue) { policy.colaStock = std::atoi(argv[++i]); }
+		else if (argument == "--cup-stock" && hasValue) { policy.cupStock = std::atoi(argv[++i]); }
+		else if (argument == "--coin-float" && hasValue) { policy.coinFloat = std::atoi(argv[++i]); }
+		else if (argument == "--restock-every" && hasValue) { policy.restockEvery = std::atoi(argv[++i]); }
+		else if (argument == "--seed" && hasValue) { seed = std::strtoull(argv[++i], nullptr, 10); }
+		else if (argument == "--csv" && hasValue) { csvName = argv[++i]; }
+		else if (argument == "--contention" && hasValue) { kiosks = std::atoi(argv[++i]); }
+		else {
+			std::cerr << "Usage: " << argv[0] << " [--machines N] [--threads N] [--commands N] [--cola-stock N] [--cup-stock N]"
+				<< " [--coin-float N] [--restock-every N] [--seed N] [--csv <file>] [--contention KIOSKS]\n";
+			return 2;
+		}
+	}
+	if (threads < 1) { threads = 1; }
+	if (amountOfMachines < 1 || policy.restockEvery < 1) {
+		std::cerr << "The fleet needs at least one machine and a restock interval of at least one command\n";
+		return 2;
+	}
+
+	if (kiosks > 0) {
+		bool passed = runContentionTest(kiosks, seed, policy);
+		std::cout << (passed ? "PASS" : "FAIL") << '\n';
+		return passed ? 0 : 1;
+	}
+
+	//runs every machine, each on whichever thread picks it up
+	std::unique_ptr<SimulatedMachine[]> fleet(new SimulatedMachine[amountOfMachines]);
+	WorkStealingPool pool(threads);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	pool.run(amountOfMachines, [&](int index) {
+		std::uint64_t machineSeed = seed * 1000003ull + static_cast<std::uint64_t>(index);
+		simulateMachine(fleet[index], machineSeed, policy);
+	});
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	//adds up the results of the whole fleet
+	PurchaseStatistics total;
+	long long commands = 0;
+	for (int i = 0; i < amountOfMachines; i++) {
+		const PurchaseStatistics& statistics = fleet[i].machine.getStatistics();
+		total.sales += statistics.sales;
+		total.soldOut += statistics.soldOut;
+		total.noChange += statistics.noChange;
+		total.noCups += statistics.noCups;
+		commands += fleet[i].commandsRun;
+	}
+
+	std::cout << "Machines:      " << amountOfMachines << " on " << threads << " threads\n";
+	std::cout << "Commands:      " << commands << " in " << std::fixed << std::setprecision(3) << seconds << " s ("
+		<< std::setprecision(0) << commands / seconds << " commands/s)\n";
+	std::cout << "Sales:         " << total.sales << '\n';
+	std::cout << "Sold out:      " << total.soldOut << '\n';
+	std::cout << "No change:     " << total.noChange << '\n';
+	std::cout << "No cups:       " << total.noCups << '\n';
+
+	//writes the results of each machine in a machine readable form
+	if (csvName != "") {
+		std::ofstream csv(csvName);
+		if (!csv) {
+			std::cerr << "Unable to open " << csvName << '\n';
+			return 2;
+		}
+
+		csv << "machine,sales,sold_out,no_change,no_cups\n";
+		for (int i = 0; i < amountOfMachines; i++) {
+			const PurchaseStatistics& statistics = fleet[i].machine.getStatistics();
+			csv << i << ',' << statistics.sales << ',' << statistics.soldOut << ',' << statistics.noChange << ',' << statistics.noCups << '\n';
+		}
+	}
+
+	return 0;
+}